@@ -0,0 +1,44 @@
+/*
+ * Timing helpers shared by the benchmark programs.
+ *
+ * Each kernel is run a number of times with timer 1 counting cpu clock
+ * cycles, and the average is written to the emulator console as a line of
+ * "bench <name> <cycles>", which tools/bench/bench.sh compares against the
+ * stored baseline.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <tice.h>
+#include <debug.h>
+
+#define BENCH_TIMER1_MASK (TIMER1_ENABLE | TIMER1_32K | TIMER1_0INT | TIMER1_UP)
+
+static inline void bench_Start(void)
+{
+    timer_Control = timer_Control & ~BENCH_TIMER1_MASK;
+    timer_1_Counter = 0;
+    timer_Control = timer_Control | TIMER1_ENABLE | TIMER1_CPU | TIMER1_NOINT | TIMER1_UP;
+}
+
+static inline uint32_t bench_Stop(void)
+{
+    timer_Control = timer_Control & ~BENCH_TIMER1_MASK;
+    return timer_1_Counter;
+}
+
+/* Runs kernel runs times, where it can use run as the iteration number */
+#define BENCH(name, runs, kernel)                                        \
+do {                                                                     \
+    unsigned int run;                                                    \
+    uint32_t cycles;                                                     \
+    bench_Start();                                                       \
+    for (run = 0; run < (runs); run++) {                                 \
+        kernel;                                                          \
+    }                                                                    \
+    cycles = bench_Stop();                                               \
+    dbg_sprintf(dbgout, "bench %s %lu\n", name, cycles / (runs));        \
+} while (0)
+
+#endif
@@ -0,0 +1,7 @@
+#include "fonts.h"
+
+static const uint8_t test_font_data[] = {
+    #include "testfont.inc"
+};
+
+const fontlib_font_t *test_font = (fontlib_font_t *)test_font_data;
@@ -0,0 +1,45 @@
+#include <tice.h>
+#include <graphx.h>
+#include <fontlibc.h>
+
+#include "fonts/fonts.h"
+#include "../../bench.h"
+
+static const char text[] = "The quick brown fox jumps over the lazy dog.";
+
+int main(void)
+{
+    gfx_Begin();
+    gfx_SetDrawBuffer();
+
+    if (!fontlib_SetFont(test_font, 0))
+    {
+        gfx_End();
+        return 1;
+    }
+
+    fontlib_SetWindowFullScreen();
+    fontlib_SetColors(0xC0, 0x20);
+    fontlib_SetNewlineOptions(0);
+
+    fontlib_SetTransparency(false);
+    BENCH("fontlib_DrawString", 64, (fontlib_SetCursorPosition(0, run), fontlib_DrawString(text)));
+    fontlib_SetTransparency(true);
+    BENCH("fontlib_DrawString_transparent", 64, (fontlib_SetCursorPosition(0, run), fontlib_DrawString(text)));
+    fontlib_SetTransparency(false);
+    BENCH("fontlib_DrawGlyph", 256, (fontlib_SetCursorPosition(run, 0), fontlib_DrawGlyph('A' + (run & 15))));
+    BENCH("fontlib_DrawUInt", 256, (fontlib_SetCursorPosition(0, 0), fontlib_DrawUInt(run * 1234, 8)));
+    BENCH("fontlib_GetStringWidth", 256, fontlib_GetStringWidth(text));
+
+    /* The window and line clearing routines work on a smaller text window */
+    fontlib_SetWindow(20, 20, 280, 200);
+    fontlib_SetNewlineOptions(FONTLIB_ENABLE_AUTO_WRAP | FONTLIB_AUTO_CLEAR_TO_EOL);
+    BENCH("fontlib_DrawString_wrap", 16, (fontlib_HomeUp(), fontlib_DrawString(text), fontlib_DrawString(text)));
+    BENCH("fontlib_ClearWindow", 16, fontlib_ClearWindow());
+    BENCH("fontlib_ScrollWindowDown", 16, fontlib_ScrollWindowDown());
+    BENCH("fontlib_ScrollWindowUp", 16, fontlib_ScrollWindowUp());
+
+    gfx_End();
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <tice.h>
+#include <graphx.h>
+#include <stdlib.h>
+
+#include "../../bench.h"
+
+#define TILE_SIZE      16
+#define TILE_COUNT     4
+#define TILEMAP_WIDTH  20
+#define TILEMAP_HEIGHT 15
+
+#define POINT_COUNT    256
+
+static uint8_t tilemap_map[TILEMAP_WIDTH * TILEMAP_HEIGHT];
+static gfx_point_t points[POINT_COUNT];
+
+/* Fills a sprite with a pattern that has some transparent pixels */
+static void fill_sprite(gfx_sprite_t *sprite, uint8_t seed)
+{
+    unsigned int i;
+    unsigned int size = sprite->width * sprite->height;
+
+    for (i = 0; i < size; i++)
+    {
+        sprite->data[i] = (i + seed) & 7 ? (uint8_t)(i + seed) : 0;
+    }
+}
+
+int main(void)
+{
+    gfx_sprite_t *sprite;
+    gfx_sprite_t *tiles[TILE_COUNT];
+    gfx_tilemap_t tilemap;
+    unsigned int i;
+
+    sprite = gfx_MallocSprite(32, 32);
+    if (sprite == NULL)
+    {
+        return 1;
+    }
+    fill_sprite(sprite, 1);
+
+    for (i = 0; i < TILE_COUNT; i++)
+    {
+        tiles[i] = gfx_MallocSprite(TILE_SIZE, TILE_SIZE);
+        if (tiles[i] == NULL)
+        {
+            return 1;
+        }
+        fill_sprite(tiles[i], i);
+    }
+    for (i = 0; i < TILEMAP_WIDTH * TILEMAP_HEIGHT; i++)
+    {
+        tilemap_map[i] = i % TILE_COUNT;
+    }
+
+    tilemap.map         = tilemap_map;
+    tilemap.tiles       = tiles;
+    tilemap.type_width  = gfx_tile_16_pixel;
+    tilemap.type_height = gfx_tile_16_pixel;
+    tilemap.tile_height = TILE_SIZE;
+    tilemap.tile_width  = TILE_SIZE;
+    tilemap.draw_height = TILEMAP_HEIGHT;
+    tilemap.draw_width  = TILEMAP_WIDTH;
+    tilemap.height      = TILEMAP_HEIGHT;
+    tilemap.width       = TILEMAP_WIDTH;
+    tilemap.y_loc       = 0;
+    tilemap.x_loc       = 0;
+
+    /* a wave crossing the edges of the screen, so some lines get clipped */
+    for (i = 0; i < POINT_COUNT; i++)
+    {
+        points[i].x = (int)(i * 2) - 96;
+        points[i].y = (int)((i * 37) % 300) - 30;
+    }
+
+    gfx_Begin();
+    gfx_SetDrawBuffer();
+
+    BENCH("gfx_FillScreen", 16, gfx_FillScreen(run));
+    BENCH("gfx_FillRectangle_NoClip", 64, gfx_FillRectangle_NoClip(run, run, 100, 100));
+    BENCH("gfx_FillRectangle_NoClip_narrow", 64, gfx_FillRectangle_NoClip(run, run, 32, 100));
+    BENCH("gfx_FillRectangle_wide", 16, gfx_FillRectangle(-run, 20, LCD_WIDTH, 200));
+    BENCH("gfx_Line_NoClip", 256, gfx_Line_NoClip(0, run % LCD_HEIGHT, LCD_WIDTH - 1, LCD_HEIGHT - 1 - run % LCD_HEIGHT));
+    BENCH("gfx_Polyline", 16, gfx_Polyline(points, POINT_COUNT, false));
+    BENCH("gfx_Polygon", 16, gfx_Polygon((int *)points, POINT_COUNT));
+    BENCH("gfx_Lines", 16, gfx_Lines(points, POINT_COUNT / 2));
+    BENCH("gfx_Pixels", 64, gfx_Pixels(points, POINT_COUNT, NULL));
+    BENCH("gfx_Blit", 16, gfx_Blit(gfx_buffer));
+    BENCH("gfx_Sprite_NoClip", 256, gfx_Sprite_NoClip(sprite, run, run % 200));
+    BENCH("gfx_TransparentSprite_NoClip", 256, gfx_TransparentSprite_NoClip(sprite, run, run % 200));
+    BENCH("gfx_Tilemap_NoClip", 16, gfx_Tilemap_NoClip(&tilemap, 0, 0));
+    BENCH("gfx_PrintStringXY", 64, gfx_PrintStringXY("The quick brown fox jumps", 0, run));
+    gfx_SetTextFGColor(1);
+    gfx_SetTextBGColor(2);
+    BENCH("gfx_PrintStringXY_opaque", 64, gfx_PrintStringXY("The quick brown fox jumps", 0, run));
+    gfx_SetTextConfig(gfx_text_clip);
+    BENCH("gfx_PrintStringXY_clip", 64, gfx_PrintStringXY("The quick brown fox jumps", 0, run));
+    gfx_SetTextConfig(gfx_text_noclip);
+    BENCH("gfx_PrintInt", 256, (gfx_SetTextXY(0, 0), gfx_PrintInt(run * 1234, 8)));
+
+    gfx_End();
+
+    for (i = 0; i < TILE_COUNT; i++)
+    {
+        free(tiles[i]);
+    }
+    free(sprite);
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+; ---
+; starts timer 1 counting cpu cycles as soon as the program is launched, so
+; main can report how long libload took to link it. the header segment runs
+; before the libload launcher, as long as the program has no icon.
+; ---
+
+	.assume	adl=1
+
+	segment	header
+
+	ld	hl,0F20030h	; timer_Control
+	ld	a,(hl)
+	and	a,0F8h		; stop timer 1, use the cpu clock without interrupts
+	ld	(hl),a
+	inc	hl
+	set	1,(hl)		; count up
+	ld	de,0
+	ld	(0F20000h),de	; timer_1_Counter
+	ld	(0F20001h),de
+	dec	hl
+	set	0,(hl)		; start timer 1
@@ -0,0 +1,252 @@
+#include <tice.h>
+#include <fileioc.h>
+#include <keypadc.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../bench.h"
+
+/*
+ * Times how long LibLoad takes to launch this program with and without its
+ * prelinked image, and checks that a stale image is rejected. Each launch
+ * runs the next step, so the autotester launches the program once per step.
+ */
+
+/* LibLoad keeps the prelinked image of BENCHLL in this appvar */
+#define IMAGE_NAME "bENCHLL"
+#define STATE_NAME "LLBENCH"
+
+/* An image starts with its key, holding the size of the program and the size
+   of its import tables, followed by the unresolved import tables, the number
+   of libraries and the size of the linked libraries, then the name and vector
+   table pointer of each library */
+#define IMAGE_PRGMSIZE   4
+#define IMAGE_IMPORTSIZE 10
+#define IMAGE_IMPORTS    13
+#define IMAGE_CHECK      256
+
+enum {
+    STEP_LINK,
+    STEP_SAVE,
+    STEP_CACHED,
+    STEP_LIBRARY_MOVED,
+    STEP_IMPORTS_SWAPPED,
+    STEP_PROGRAM_CHANGED
+};
+
+typedef struct {
+    uint8_t step;
+    uint32_t linked;
+    size_t imports;
+    uint8_t image[IMAGE_CHECK];
+} state_t;
+
+static state_t state;
+
+static int fail(const char *msg)
+{
+    ti_CloseAll();
+    ti_Delete(IMAGE_NAME);
+    ti_Delete(STATE_NAME);
+
+    /* Stay on the error until a key is pressed */
+    os_ClrHome();
+    os_PutStrFull(msg);
+    while (!os_GetCSC());
+    return 1;
+}
+
+static bool image_Read(uint8_t *image)
+{
+    ti_var_t slot = ti_Open(IMAGE_NAME, "r");
+    bool read;
+
+    if (!slot)
+    {
+        return false;
+    }
+    /* Images can be shorter than the checked part */
+    memset(image, 0, IMAGE_CHECK);
+    read = ti_Read(image, 1, IMAGE_CHECK, slot) > IMAGE_IMPORTS;
+    ti_Close(slot);
+
+    return read && !memcmp(image, "LLC\x02", 4);
+}
+
+/* Gets the size of the import tables stored in the image */
+static size_t image_Imports(const uint8_t *image)
+{
+    return image[IMAGE_IMPORTSIZE] |
+           (size_t)image[IMAGE_IMPORTSIZE + 1] << 8 |
+           (size_t)image[IMAGE_IMPORTSIZE + 2] << 16;
+}
+
+static bool image_Matches(void)
+{
+    uint8_t image[IMAGE_CHECK];
+
+    return image_Read(image) && !memcmp(image, state.image, IMAGE_CHECK);
+}
+
+/* Changes a byte of the key so the image no longer matches */
+static bool image_Invalidate(unsigned int offset)
+{
+    ti_var_t slot = ti_Open(IMAGE_NAME, "r+");
+    uint8_t byte = ~state.image[offset];
+    bool written;
+
+    if (!slot)
+    {
+        return false;
+    }
+    ti_Seek(offset, SEEK_SET, slot);
+    written = ti_Write(&byte, 1, 1, slot) == 1;
+    ti_Close(slot);
+
+    return written;
+}
+
+/* Swaps two different bytes of the stored import tables, which keeps their
+   size and the sum of their bytes the same */
+static bool image_Swap(void)
+{
+    ti_var_t slot;
+    unsigned int offset;
+    uint8_t bytes[2];
+    bool written;
+
+    for (offset = IMAGE_IMPORTS + state.imports - 2; offset > IMAGE_IMPORTS; offset--)
+    {
+        if (state.image[offset] != state.image[offset + 1])
+        {
+            break;
+        }
+    }
+
+    slot = ti_Open(IMAGE_NAME, "r+");
+    if (!slot)
+    {
+        return false;
+    }
+    bytes[0] = state.image[offset + 1];
+    bytes[1] = state.image[offset];
+    ti_Seek(offset, SEEK_SET, slot);
+    written = ti_Write(bytes, 2, 1, slot) == 1;
+    ti_Close(slot);
+
+    return written;
+}
+
+int main(void)
+{
+    /* Timer 1 was started by launch.asm, before LibLoad ran */
+    uint32_t cycles = bench_Stop();
+    ti_var_t slot;
+
+    /* Use a second library so there is more for LibLoad to link */
+    kb_Scan();
+
+    ti_CloseAll();
+
+    slot = ti_Open(STATE_NAME, "r");
+    if (slot)
+    {
+        ti_Read(&state, sizeof state, 1, slot);
+        ti_Close(slot);
+    }
+
+    switch (state.step)
+    {
+        case STEP_LINK:
+            dbg_sprintf(dbgout, "bench libload_link %lu\n", cycles);
+            state.linked = cycles;
+
+            /* An empty appvar has LibLoad save the image on the next launch */
+            slot = ti_Open(IMAGE_NAME, "w");
+            if (!slot)
+            {
+                return fail("Could not enable the image");
+            }
+            ti_Close(slot);
+            break;
+
+        case STEP_SAVE:
+            dbg_sprintf(dbgout, "bench libload_link_save %lu\n", cycles);
+            if (!image_Read(state.image))
+            {
+                return fail("Image not saved");
+            }
+
+            /* The first library entry has to be within the checked part */
+            state.imports = image_Imports(state.image);
+            if (IMAGE_IMPORTS + state.imports + 1 + 3 + 12 > IMAGE_CHECK)
+            {
+                return fail("Import tables too large");
+            }
+            break;
+
+        case STEP_CACHED:
+            dbg_sprintf(dbgout, "bench libload_cached %lu\n", cycles);
+            if (cycles >= state.linked || !image_Matches())
+            {
+                return fail("Image not used");
+            }
+
+            /* Looks like the first library was moved by a garbage collect */
+            if (!image_Invalidate(IMAGE_IMPORTS + state.imports + 1 + 3 + 9))
+            {
+                return fail("Could not change the image");
+            }
+            break;
+
+        case STEP_LIBRARY_MOVED:
+            dbg_sprintf(dbgout, "bench libload_relink %lu\n", cycles);
+            if (!image_Matches())
+            {
+                return fail("Stale library in image");
+            }
+
+            /* Looks like the program was rebuilt with its imports reordered */
+            if (!image_Swap())
+            {
+                return fail("Could not change the image");
+            }
+            break;
+
+        case STEP_IMPORTS_SWAPPED:
+            dbg_sprintf(dbgout, "bench libload_relink_imports %lu\n", cycles);
+            if (!image_Matches())
+            {
+                return fail("Stale imports in image");
+            }
+
+            /* Looks like the program was rebuilt with a different size */
+            if (!image_Invalidate(IMAGE_PRGMSIZE))
+            {
+                return fail("Could not change the image");
+            }
+            break;
+
+        case STEP_PROGRAM_CHANGED:
+            if (!image_Matches())
+            {
+                return fail("Stale program in image");
+            }
+            ti_Delete(IMAGE_NAME);
+            ti_Delete(STATE_NAME);
+            return 0;
+
+        default:
+            return fail("Unknown step");
+    }
+
+    state.step++;
+    slot = ti_Open(STATE_NAME, "w");
+    if (!slot || ti_Write(&state, sizeof state, 1, slot) != 1)
+    {
+        return fail("Could not save the state");
+    }
+    ti_Close(slot);
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include <tice.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../bench.h"
+
+#define BUFFER_SIZE 4096
+#define SORT_COUNT  256
+
+static uint8_t source[BUFFER_SIZE];
+static uint8_t destination[BUFFER_SIZE];
+static int values[SORT_COUNT];
+
+static volatile float fa = 3.14159f;
+static volatile float fb = 2.71828f;
+static volatile float fr;
+static volatile long lr;
+
+static int compare(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/* Fills the values with a fixed pseudo random sequence */
+static void shuffle(void)
+{
+    unsigned int i;
+    unsigned int x = 12345;
+
+    for (i = 0; i < SORT_COUNT; i++)
+    {
+        x = x * 1103515245 + 12345;
+        values[i] = x >> 8;
+    }
+}
+
+int main(void)
+{
+    void *blocks[16];
+    unsigned int i;
+
+    for (i = 0; i < BUFFER_SIZE; i++)
+    {
+        source[i] = i;
+    }
+
+    BENCH("memcpy", 16, memcpy(destination, source, BUFFER_SIZE));
+    BENCH("memset", 16, memset(destination, run, BUFFER_SIZE));
+    BENCH("memmove", 16, memmove(destination + 1, destination, BUFFER_SIZE - 1));
+    BENCH("malloc_free", 16,
+        for (i = 0; i < 16; i++) blocks[i] = malloc(64 + i * 8);
+        for (i = 0; i < 16; i++) free(blocks[i]));
+    BENCH("qsort", 4, shuffle(); qsort(values, SORT_COUNT, sizeof(int), compare));
+    BENCH("float_add", 256, fr = fa + fb);
+    BENCH("float_mul", 256, fr = fa * fb);
+    BENCH("float_div", 256, fr = fa / fb);
+    BENCH("float_to_long", 256, lr = (long)fa);
+    BENCH("long_to_float", 256, fr = (float)(long)run);
+
+    return 0;
+}
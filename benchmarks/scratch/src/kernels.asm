@@ -0,0 +1,56 @@
+; ---
+; kernels timed from ram and from the scratchpad. they only use relative
+; jumps, so they can run wherever they are copied.
+; ---
+
+	.def	_kernel_Checksum
+	.def	_kernel_Translate
+	.def	_kernel_End
+	.assume	adl=1
+
+	segment code
+
+;-------------------------------------------------------------------------------
+; uint24_t kernel_Checksum(const uint8_t *data, size_t size)
+_kernel_Checksum:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy+3)
+	ld	bc,(iy+6)
+	ld	de,0
+checksum_loop:
+	ld	a,(hl)
+	add	a,e
+	ld	e,a
+	jr	nc,checksum_carry
+	inc	d
+checksum_carry:
+	inc	hl
+	dec	bc
+	ld	a,b
+	or	a,c
+	jr	nz,checksum_loop
+	ex	de,hl
+	ret
+
+;-------------------------------------------------------------------------------
+; void kernel_Translate(uint8_t *data, size_t size, const uint8_t *table)
+; table is aligned to 256 bytes
+_kernel_Translate:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy+3)
+	ld	bc,(iy+6)
+	ld	de,(iy+9)
+translate_loop:
+	ld	e,(hl)
+	ld	a,(de)
+	ld	(hl),a
+	inc	hl
+	dec	bc
+	ld	a,b
+	or	a,c
+	jr	nz,translate_loop
+	ret
+
+_kernel_End:
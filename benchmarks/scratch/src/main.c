@@ -0,0 +1,68 @@
+#include <tice.h>
+#include <scratch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../bench.h"
+
+#define OWNER     1
+#define DATA_SIZE 256
+
+typedef uint24_t (*checksum_t)(const uint8_t *data, size_t size);
+typedef void (*translate_t)(uint8_t *data, size_t size, const uint8_t *table);
+
+uint24_t kernel_Checksum(const uint8_t *data, size_t size);
+void kernel_Translate(uint8_t *data, size_t size, const uint8_t *table);
+void kernel_End(void);
+
+static uint8_t data[DATA_SIZE];
+static uint8_t table_ram[512];
+
+int main(void)
+{
+    uint8_t *kernels;
+    uint8_t *table;
+    uint8_t *data_scratch;
+    uint8_t *table_scratch;
+    checksum_t checksum;
+    translate_t translate;
+    size_t size = (uint8_t *)kernel_End - (uint8_t *)kernel_Checksum;
+    volatile uint24_t sum;
+    unsigned int i;
+
+    /* The translate kernel needs a table aligned to 256 bytes */
+    table = (uint8_t *)(((uint24_t)table_ram + 255) & ~(uint24_t)255);
+    table_scratch = scratch_Reserve((uint8_t *)SCRATCH_BASE + 256, 256, OWNER);
+    kernels = scratch_Alloc(size, OWNER);
+    data_scratch = scratch_Alloc(DATA_SIZE, OWNER);
+    if (table_scratch == NULL || kernels == NULL || data_scratch == NULL)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        data[i] = i;
+        data_scratch[i] = i;
+        table[i] = 255 - i;
+        table_scratch[i] = 255 - i;
+    }
+
+    /* Run copies of the kernels from the scratchpad */
+    memcpy(kernels, (void *)kernel_Checksum, size);
+    checksum = (checksum_t)kernels;
+    translate = (translate_t)(kernels + ((uint8_t *)kernel_Translate - (uint8_t *)kernel_Checksum));
+
+    BENCH("checksum_ram", 64, sum = kernel_Checksum(data, DATA_SIZE));
+    BENCH("checksum_code_scratch", 64, sum = checksum(data, DATA_SIZE));
+    BENCH("checksum_data_scratch", 64, sum = kernel_Checksum(data_scratch, DATA_SIZE));
+    BENCH("checksum_all_scratch", 64, sum = checksum(data_scratch, DATA_SIZE));
+    BENCH("translate_ram", 64, kernel_Translate(data, DATA_SIZE, table));
+    BENCH("translate_code_scratch", 64, translate(data, DATA_SIZE, table));
+    BENCH("translate_table_scratch", 64, kernel_Translate(data, DATA_SIZE, table_scratch));
+    BENCH("translate_all_scratch", 64, translate(data_scratch, DATA_SIZE, table_scratch));
+
+    scratch_Free(OWNER);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <tice.h>
+
+/* A table that compresses well, checked to make sure the launcher restored it */
+#define B4(n)   (n), (n) + 1, (n) + 2, (n) + 3
+#define B16(n)  B4(n), B4((n) + 4), B4((n) + 8), B4((n) + 12)
+#define B64(n)  B16(n), B16((n) + 16), B16((n) + 32), B16((n) + 48)
+#define B256    B64(0), B64(64), B64(128), B64(192)
+
+static const uint8_t table[] = {
+    B256, B256, B256, B256, B256, B256, B256, B256,
+    B256, B256, B256, B256, B256, B256, B256, B256
+};
+
+int main(void)
+{
+    unsigned int i;
+
+    /* Clear the homescreen */
+    os_ClrHome();
+
+    for (i = 0; i < sizeof table; i++)
+    {
+        if (table[i] != (uint8_t)i)
+        {
+            /* Stay on the error until a key is pressed */
+            os_PutStrFull("Decompression failed");
+            while (!os_GetCSC());
+            return 1;
+        }
+    }
+
+    os_PutStrFull("Decompressed correctly");
+    delay(100);
+
+    return 0;
+}
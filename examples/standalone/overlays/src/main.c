@@ -0,0 +1,53 @@
+#include <tice.h>
+#include <overlay.h>
+
+#include "work.h"
+
+#define SLOT_SIZE 512
+#define SLOTS     2
+#define RUNS      4
+
+static uint8_t region[SLOT_SIZE * SLOTS];
+static uint8_t buffer[256];
+
+int main(void)
+{
+    ovl_stats_t stats;
+    unsigned int run;
+    int ok = 1;
+
+    /* Clear the homescreen */
+    os_ClrHome();
+
+    /* Give the overlay manager a slot for each group */
+    ovl_Init(region, SLOT_SIZE, SLOTS);
+
+    for (run = 0; run < RUNS; run++)
+    {
+        fill_Bytes(buffer, sizeof buffer, run);
+        if (sum_Bytes(buffer, sizeof buffer) != run * sizeof buffer)
+        {
+            ok = 0;
+        }
+    }
+
+    /* Each group has its own slot, so it is only loaded once */
+    ovl_GetStats(&stats);
+    if (stats.calls != RUNS * 2 || stats.loads != 2)
+    {
+        ok = 0;
+    }
+
+    if (!ok)
+    {
+        /* Stay on the error until a key is pressed */
+        os_PutStrFull("Overlays failed");
+        while (!os_GetCSC());
+        return 1;
+    }
+
+    os_PutStrFull("Overlays loaded correctly");
+    delay(100);
+
+    return 0;
+}
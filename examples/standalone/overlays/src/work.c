@@ -0,0 +1,21 @@
+#include "work.h"
+
+void fill_Bytes(uint8_t *dst, size_t length, uint8_t value)
+{
+    while (length--)
+    {
+        *dst++ = value;
+    }
+}
+
+unsigned int sum_Bytes(const uint8_t *src, size_t length)
+{
+    unsigned int sum = 0;
+
+    while (length--)
+    {
+        sum += *src++;
+    }
+
+    return sum;
+}
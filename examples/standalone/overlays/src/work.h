@@ -0,0 +1,13 @@
+#ifndef WORK_H
+#define WORK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Stored in the OVLFILL overlay group */
+void fill_Bytes(uint8_t *dst, size_t length, uint8_t value);
+
+/* Stored in the OVLSUM overlay group */
+unsigned int sum_Bytes(const uint8_t *src, size_t length);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Code overlays loaded from appvars on demand
+ *
+ * Functions listed in an overlay group of the makefile are stored in an
+ * appvar named after the group instead of in the program. Calling one of them
+ * loads its group into the least recently used slot of the overlay region,
+ * unless it is already loaded, and runs it from there. A slot is not reused
+ * while one of its functions is running, so nested calls across groups need
+ * a slot for each group involved.
+ *
+ * @code
+ * OVERLAYS        := BATTLE SHOP
+ * OVERLAY_BATTLE  := battle_Run battle_Draw
+ * OVERLAY_SHOP    := shop_Run
+ * @endcode
+ *
+ * Load times are measured with timer 3, which should be left running while
+ * overlays are in use. ovl_Init() sets it to count up from the 32768 Hz
+ * crystal, unless it is already counting up. Programs built with
+ * INSTRUMENT=YES have timer 3 counting cpu cycles for the trace, so their load
+ * times are in cpu cycles instead.
+ */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Overlay manager statistics
+ */
+typedef struct {
+    uint24_t calls; /**< Calls made to overlay functions */
+    uint24_t loads; /**< Groups loaded into a slot */
+    uint32_t ticks; /**< Time spent loading groups, in timer 3 ticks */
+} ovl_stats_t;
+
+/**
+ * Sets up the region overlay groups are loaded into, and resets the
+ * statistics. This must be called before any overlay function.
+ *
+ * @param region Pointer to slots * slot_size bytes of ram
+ * @param slot_size Size of a slot, at least the size of the largest group
+ * @param slots Number of slots, up to 8
+ */
+void ovl_Init(void *region, size_t slot_size, uint8_t slots);
+
+/**
+ * Gets the overlay manager statistics
+ *
+ * @param stats Pointer to statistics to fill in
+ */
+void ovl_GetStats(ovl_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Scratchpad allocator for the lcd cursor image ram
+ *
+ * The 1024 bytes of lcd cursor image ram are on chip and run faster than the
+ * rest of ram, for both code and data. This allocator hands them out in
+ * granules of 16 bytes, each held by an owner, so that tables and relocatable
+ * inner loops of different parts of a program can share them.
+ *
+ * The fastcode section is held by ::SCRATCH_FASTCODE when it is located in
+ * the cursor ram. gfx_FillScreen() and gfx_FillRectangle() of wide rectangles
+ * overwrite the first ::SCRATCH_FILLSCREEN_SIZE bytes, so programs using them
+ * should reserve those bytes, or save their owners around the calls:
+ *
+ * @code
+ * scratch_Reserve(SCRATCH_BASE, SCRATCH_FILLSCREEN_SIZE, MY_OWNER);
+ * @endcode
+ *
+ * The graphx hardware cursor images are kept in the cursor ram as well, and
+ * are not tracked by this allocator. At its default location, the fastcode
+ * section overlaps 32x32 images 1 to 3 and any 64x64 image.
+ *
+ * int_Initialize() builds its vector table over the whole cursor ram, which
+ * can't be used while custom interrupts are.
+ */
+
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCRATCH_BASE            ((void*)0xE30800) /**< Start of the lcd cursor image ram */
+#define SCRATCH_SIZE            1024              /**< Size of the lcd cursor image ram  */
+#define SCRATCH_GRANULE         16                /**< Allocation granularity            */
+#define SCRATCH_FASTCODE        255               /**< Owner of the fastcode section     */
+#define SCRATCH_FILLSCREEN_SIZE 128               /**< Bytes used by gfx_FillScreen()    */
+
+/**
+ * Allocates scratchpad ram
+ *
+ * @param size Bytes to allocate
+ * @param owner Nonzero owner of the allocation
+ * @returns Pointer to the first free run of granules that fits, aligned to
+ * ::SCRATCH_GRANULE, or NULL if there is none.
+ */
+void *scratch_Alloc(size_t size, uint8_t owner);
+
+/**
+ * Reserves a fixed range of scratchpad ram, for code or data that has to be
+ * at a given address
+ *
+ * @param address Start of the range
+ * @param size Bytes to reserve
+ * @param owner Nonzero owner of the range
+ * @returns \p address, or NULL if part of the range is outside of the
+ * scratchpad or held by another owner.
+ */
+void *scratch_Reserve(void *address, size_t size, uint8_t owner);
+
+/**
+ * Frees all of the scratchpad ram held by an owner
+ *
+ * @param owner Owner to free
+ */
+void scratch_Free(uint8_t owner);
+
+/**
+ * Gets the owner of a scratchpad address
+ *
+ * @param address Address to look up
+ * @returns Owner of the granule holding \p address, or 0 if it is free or
+ * outside of the scratchpad.
+ */
+uint8_t scratch_Owner(const void *address);
+
+/**
+ * Gets the size of the buffer scratch_Save() needs for an owner
+ *
+ * @param owner Owner to save
+ * @returns Size of the buffer in bytes
+ */
+size_t scratch_SaveSize(uint8_t owner);
+
+/**
+ * Copies the scratchpad ram held by an owner to a buffer, and frees it so
+ * that library routines or other owners can use it until scratch_Restore()
+ *
+ * @param owner Owner to save
+ * @param buffer Buffer of scratch_SaveSize() bytes
+ */
+void scratch_Save(uint8_t owner, void *buffer);
+
+/**
+ * Reserves the scratchpad ram saved by scratch_Save() for an owner again,
+ * and copies its contents back
+ *
+ * @param owner Owner to restore
+ * @param buffer Buffer passed to scratch_Save()
+ * @returns false if part of it is now held by another owner, in which case
+ * nothing is restored.
+ */
+bool scratch_Restore(uint8_t owner, const void *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -235,9 +235,9 @@ uint32_t atomic_load_decreasing_32(volatile uint32_t *p);
 #define lcd_CrsrXY               (*(volatile uint32_t*)0xE30C10)
 #define lcd_CrsrX                (*(volatile uint16_t*)0xE30C10)
 #define lcd_CrsrY                (*(volatile uint16_t*)0xE30C12)
-#define lcd_CrsrClip             (*(volatile uint16_t*)0xE30C04)
-#define lcd_CrsrClipX            (*(volatile uint8_t*)0xE30C04)
-#define lcd_CrsrClipY            (*(volatile uint8_t*)0xE30C05)
+#define lcd_CrsrClip             (*(volatile uint16_t*)0xE30C14)
+#define lcd_CrsrClipX            (*(volatile uint8_t*)0xE30C14)
+#define lcd_CrsrClipY            (*(volatile uint8_t*)0xE30C15)
 #define lcd_CrsrEnableInt        (*(volatile uint8_t*)0xE30C20)
 #define lcd_CrsrIntAcknowledge   (*(volatile uint8_t*)0xE30C24)
 #define lcd_CrsrIntStatus        (*(volatile uint8_t*)0xE30C28)
@@ -37,10 +37,28 @@ library 'FATDRVCE',0
 	export msd_WriteSector
 	export msd_SetJmpBuf
 	export msd_Deinit
+	export msd_ReadSectors
+	export msd_WriteSectors
+	export fat_ReadSectors
+	export fat_WriteSectors
+	export fat_SetCache
+	export fat_Flush
+	export fat_Read
+	export fat_Write
+	export fat_OpenDir
+	export fat_RewindDir
+	export fat_ReadDir
+	export fat_FindEntry
+	export fat_ReadDirLong
+	export msd_ReadSectorsAsync
+	export msd_WriteSectorsAsync
+	export msd_Poll
+	export msd_Wait
 ;-------------------------------------------------------------------------------
 
 include 'host.inc'
 include 'msd.inc'
+include 'cache.inc'
 
 ;-------------------------------------------------------------------------------
 ; Copyright (c) 2015 Steven Arnow <s@rdw.se>
@@ -102,6 +120,82 @@ _fat_key:
 
 MAX_OPEN_FD  := 3
 FD_SIZE      := 23
+
+FAT_EXTENT_MAX := 8			; maximum cluster runs tracked per file
+
+mapCount	:= 0			; number of extents, 0 if not built
+mapIndex	:= mapCount+1		; file cluster index of last mapped cluster
+mapLast		:= mapIndex+3		; last mapped cluster
+mapExtents	:= mapLast+4
+mapSize		:= mapExtents+FAT_EXTENT_MAX*7
+
+extIndex	:= 0			; file cluster index of start of run
+extCluster	:= extIndex+3		; first cluster of run
+extSize		:= extCluster+4
+
+fat.maps:
+	rb	MAX_OPEN_FD * mapSize
+
+FAT_FREEMAP_BITS := 2048		; groups of fat sectors tracked as full
+
+fat.freemap:
+	rb	FAT_FREEMAP_BITS / 8
+fat.freemapshift:
+	db	0			; log2 of fat sectors per group
+fat.freemapgroup:
+	dl	0			; fat sectors per group
+fat.freemapgroups:
+	dl	0			; groups in use
+fat.fsinfo:
+	dl	0			; fsinfo sector, 0 if none
+fat.freecount:
+	dd	0			; free clusters, -1 if unknown
+fat.nextfree:
+	dd	0			; cluster to start searching from
+
+FAT_PATH_CACHE_MAX := 4			; resolved directories remembered
+FAT_PATH_MAX	:= 42			; longest directory path remembered
+
+pathLen		:= 0			; length of path, 0 if unused
+pathHash	:= pathLen+1		; hash of path
+pathCluster	:= pathHash+1		; first cluster of directory
+pathName	:= pathCluster+4
+pathSize	:= pathName+FAT_PATH_MAX
+
+fat.paths:
+	rb	FAT_PATH_CACHE_MAX * pathSize
+fat.pathnext:
+	db	0			; entry to replace next
+fat.pathstart:
+	dl	0			; path being resolved
+fat.pathactive:
+	db	0			; nonzero if prefixes of the path can be remembered
+
+dirFirst	:= 0			; first cluster, 0 for the root directory
+dirCluster	:= dirFirst+4		; current cluster, 0 for a fixed root directory
+dirSector	:= dirCluster+4		; current sector
+dirLeft		:= dirSector+4		; sectors left in cluster or root directory
+dirIndex	:= dirLeft+2		; next entry in sector
+
+FAT_LFN_MAX	:= 20			; most entries in a long filename
+
+fat.lfn.stage:
+	rb	13			; characters of the current long name entry
+fat.lfn.mode:
+	db	0			; 0 to assemble the long name, 1 to match it
+fat.lfn.buffer:
+	dl	0			; assembled long name
+fat.lfn.name:
+	dl	0			; name to match
+fat.lfn.length:
+	db	0			; length of name to match
+fat.lfn.valid:
+	db	0			; long name belongs to the entry
+fat.lfn.ord:
+	db	0			; next expected long name entry
+fat.lfn.sum:
+	db	0			; checksum of the short name
+
 FAT_DIR      := 16
 FAT_O_WRONLY := 2
 FAT_O_RDONLY := 1
@@ -114,6 +208,600 @@ fat_ReadSector:
 fat_WriteSector:
 	jp	_fat_write_sect
 
+;-------------------------------------------------------------------------------
+fat_ReadSectors:
+	ld	hl,scsiRead10Lba
+	ld	de,scsiRequestReadSectors
+	xor	a,a
+	jr	fat.xfersectors
+
+;-------------------------------------------------------------------------------
+fat_WriteSectors:
+	ld	hl,scsiWrite10Lba
+	ld	de,scsiRequestWriteSectors
+	ld	a,1
+;	jr	fat.xfersectors
+
+;-------------------------------------------------------------------------------
+fat.xfersectors:
+; transfers sectors starting at the current file position, issuing a single
+; scsi command for each run of contiguous clusters
+; a = nonzero if writing
+; hl -> scsi lba storage
+; de -> scsi sector request routine
+	ld	(.lba),hl
+	ld	(.request),de
+	ld	(.write),a
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 6)
+	ld	(.buffer),hl
+	ld	a,(iy + 9)
+	ld	(.count),a
+	ld	l,(iy + 3)
+	call	fat.findfd
+	ld	a,(.write)
+	or	a,a
+	jr	z,.read
+	ld	a,(iy + 22)			; if (!desc->write) return 0
+	or	a,a
+	ret	z
+	jr	.start
+.read:
+	ld	hl,(iy + 18)
+	ld	e,(iy + 21)
+	ld	bc,(iy + 14)
+	ld	a,(iy + 17)
+	call	__lcmpu				; if (desc->fpos >= desc->file_size) return 0
+	jq	z,.zero
+	jq	c,.zero
+	call	__lsub				; remaining = desc->file_size - desc->fpos
+	ld	bc,511
+	add	hl,bc
+	ld	a,e
+	adc	a,0
+	jr	nz,.start			; at least 256 sectors remain
+	dec	sp
+	push	hl
+	inc	sp
+	pop	bc				; b = hlu, c = h
+	srl	b
+	jr	nz,.start
+	rr	c				; c = remaining sectors, rounded up
+	ld	a,(.count)
+	cp	a,c
+	jr	c,.start
+	ld	a,c
+	ld	(.count),a			; count = min(count, remaining)
+.start:
+	ld	(.desc),iy
+	xor	a,a
+	ld	(.done),a
+.run:
+	ld	a,(.count)
+	or	a,a
+	jq	z,.finish
+	ld	iy,(.desc)
+	ld	hl,(iy + 10)
+	ld	e,(iy + 13)
+	call	__lcmpzero			; if (!desc->current_cluster) break
+	jq	z,.finish
+	push	de
+	push	hl
+	call	fat.cluster2sector
+	pop	bc
+	pop	bc
+	ld	iy,(.desc)
+	ld	a,(iy + 15)
+	rrca
+	and	a,$7f
+	ld	c,a
+	ld	a,(_fat_state + 1)
+	dec	a
+	and	a,c				; offset = (fpos >> 9) % cluster_size
+	ld	(.offset),a
+	ld	bc,0
+	ld	c,a
+	add	hl,bc
+	ld	a,e
+	adc	a,b
+	ld	(.sector),hl
+	ld	(.sector + 3),a			; sector = cluster_to_sector(current_cluster) + offset
+	xor	a,a
+	ld	(.runlen),a
+.extend:
+	ld	a,(.runlen)
+	ld	c,a
+	ld	a,(.count)
+	sub	a,c
+	ld	c,a				; c = sectors still needed
+	ld	a,(.offset)
+	ld	b,a
+	ld	a,(_fat_state + 1)
+	sub	a,b				; a = sectors left in cluster
+	cp	a,c
+	jr	c,.wholecluster
+	jr	z,.wholecluster
+	ld	a,c
+	call	.advance			; run ends inside this cluster
+	jr	.transfer
+.wholecluster:
+	call	.advance
+	call	.nextcluster
+	jr	nz,.transfer			; next cluster is not contiguous
+	ld	a,(.runlen)
+	ld	hl,.count
+	cp	a,(hl)
+	jr	nc,.transfer
+	xor	a,a
+	ld	(.offset),a
+	jr	.extend
+.transfer:
+	ld	hl,(.sector)
+	ld	a,(.sector + 3)
+	ld	e,a
+	ld	a,(.write)
+	ld	c,a
+	ld	a,(.runlen)
+	call	cache.sync			; keep cached sectors coherent
+	ld	hl,(.sector)
+	ld	a,(.sector + 3)
+	ld	e,a
+	ld	bc,0
+.lba := $ - 3
+	call	fat.addpartitionlba
+	ld	de,(.buffer)
+	ld	a,(.runlen)
+	call	0				; transfer the entire run at once
+.request := $ - 3
+	ld	a,(.runlen)
+	ld	c,a
+	ld	hl,.done
+	add	a,(hl)
+	ld	(hl),a				; done += runlen
+	ld	hl,.count
+	ld	a,(hl)
+	sub	a,c
+	ld	(hl),a				; count -= runlen
+	or	a,a
+	sbc	hl,hl
+	ld	h,c
+	add	hl,hl
+	ld	de,(.buffer)
+	add	hl,de
+	ld	(.buffer),hl			; buffer += runlen * 512
+	jq	.run
+.finish:
+	ld	iy,(.desc)
+	ld	a,(.write)
+	or	a,a
+	jr	nz,.updatesize
+	ld	hl,(iy + 18)
+	ld	e,(iy + 21)
+	ld	bc,(iy + 14)
+	ld	a,(iy + 17)
+	call	__lcmpu				; if (desc->file_size < desc->fpos)
+	jr	nc,.return
+	ld	(iy + 14),hl
+	ld	(iy + 17),e			; desc->fpos = desc->file_size
+	jr	.return
+.updatesize:
+	ld	hl,(iy + 14)
+	ld	e,(iy + 17)
+	ld	bc,(iy + 18)
+	ld	a,(iy + 21)
+	call	__lcmpu				; if (desc->fpos > desc->file_size)
+	jr	z,.return
+	jr	c,.return
+	ld	(iy + 18),hl
+	ld	(iy + 21),e			; desc->file_size = desc->fpos
+	call	fat.updatesize
+.return:
+	ld	a,(.done)
+	ret
+.zero:
+	xor	a,a
+	ret
+
+.advance:
+; a = number of sectors to add to the current run
+	ld	c,a
+	ld	hl,.runlen
+	add	a,(hl)
+	ld	(hl),a
+	ld	hl,.offset
+	ld	a,c
+	add	a,(hl)
+	ld	(hl),a
+	ld	iy,(.desc)
+	or	a,a
+	sbc	hl,hl
+	ld	h,c
+	add	hl,hl
+	ld	de,(iy + 14)
+	add	hl,de
+	ld	(iy + 14),hl			; desc->fpos += sectors * 512
+	ret	nc
+	inc	(iy + 17)
+	ret
+
+.nextcluster:
+; moves to the next cluster in the chain, allocating one when writing
+; returns z if the new cluster directly follows the old one
+	ld	iy,(.desc)
+	ld	hl,(iy + 10)
+	ld	e,(iy + 13)
+	ld	(.oldcluster),hl
+	ld	a,e
+	ld	(.oldcluster + 3),a
+	push	de
+	push	hl
+	call	fat.nextcluster
+	pop	bc
+	pop	bc
+	call	__lcmpzero
+	jr	nz,.gotcluster
+	ld	a,(.write)
+	or	a,a
+	jr	z,.gotcluster
+	ld	iy,(.desc)
+	ld	a,(.oldcluster + 3)
+	ld	c,a
+	ld	b,0
+	push	bc
+	ld	bc,(.oldcluster)
+	push	bc
+	ld	c,(iy + 5)
+	push	bc
+	ld	c,(iy + 4)
+	push	bc
+	ld	bc,(iy + 1)
+	push	bc
+	call	fat.alloc_cluster		; alloc_cluster(entry_sector, entry_index, old_cluster)
+	pop	bc, bc, bc, bc, bc
+.gotcluster:
+	ld	iy,(.desc)
+	ld	(iy + 10),hl
+	ld	(iy + 13),e
+	push	hl
+	ld	hl,(.oldcluster)
+	ld	a,(.oldcluster + 3)
+	ld	bc,1
+	add	hl,bc
+	adc	a,b
+	push	hl
+	pop	bc
+	pop	hl
+	jp	__lcmpu				; current_cluster == old_cluster + 1
+
+.desc:
+	dl	0
+.buffer:
+	dl	0
+.sector:
+	dd	0
+.oldcluster:
+	dd	0
+.write:
+	db	0
+.count:
+	db	0
+.done:
+	db	0
+.offset:
+	db	0
+.runlen:
+	db	0
+
+;-------------------------------------------------------------------------------
+fat.updatesize:
+; writes the file size of a descriptor to its directory entry
+; iy -> file descriptor
+	push	iy
+	ld	hl,(iy + 1)
+	ld	e,(iy + 4)
+	call	fat.readsector			; read_sector(desc->entry_sector)
+	pop	iy
+	or	a,a
+	sbc	hl,hl
+	ld	l,(iy + 5)
+	add	hl,hl
+	add	hl,hl
+	add	hl,hl
+	add	hl,hl
+	add	hl,hl
+	ld	bc,28
+	add	hl,bc
+	ld	bc,(fat.sectorbuffer)
+	add	hl,bc
+	ld	bc,(iy + 18)
+	ld	(hl),bc
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	a,(iy + 21)
+	ld	(hl),a				; SET32(sector_buff + (entry_index * 32 + 28), file_size)
+	ld	hl,(iy + 1)
+	ld	e,(iy + 4)
+	jp	fat.writesector			; write_sector(desc->entry_sector)
+
+;-------------------------------------------------------------------------------
+fat_Read:
+	xor	a,a
+	jr	fat.xferbytes
+
+;-------------------------------------------------------------------------------
+fat_Write:
+	ld	a,1
+;	jr	fat.xferbytes
+
+;-------------------------------------------------------------------------------
+fat.xferbytes:
+; transfers bytes starting at the current file position
+; sector aligned runs are passed to fat.xfersectors, and partial sectors are
+; read and modified through the sector cache
+; a = nonzero if writing
+	ld	(.write),a
+	ld	iy,0
+	add	iy,sp
+	ld	a,(iy + 3)
+	ld	(.fd),a
+	ld	hl,(iy + 6)
+	ld	(.buffer),hl
+	ld	hl,(iy + 9)
+	ld	(.len),hl
+	xor	a,a
+	ld	(.grown),a
+	sbc	hl,hl
+	ld	(.done),hl
+	ld	l,(iy + 3)
+	call	fat.findfd
+	ld	(.desc),iy
+	ld	a,(.write)
+	or	a,a
+	jr	z,.read
+	ld	a,(iy + 22)			; if (!desc->write) return 0
+	or	a,a
+	jr	nz,.loop
+	sbc	hl,hl
+	ret
+.read:
+	ld	hl,(iy + 18)
+	ld	e,(iy + 21)
+	ld	bc,(iy + 14)
+	ld	a,(iy + 17)
+	call	__lcmpu				; if (desc->fpos >= desc->file_size) return 0
+	jq	z,.return
+	jq	c,.return
+	call	__lsub				; remaining = desc->file_size - desc->fpos
+	ld	a,e
+	or	a,a
+	jr	nz,.loop
+	ld	de,(.len)
+	sbc	hl,de
+	jr	nc,.loop
+	add	hl,de
+	ld	(.len),hl			; len = min(len, remaining)
+.loop:
+	ld	hl,(.len)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jq	z,.finish
+	ld	iy,(.desc)
+	ld	a,(iy + 15)
+	and	a,1
+	or	a,(iy + 14)
+	jr	nz,.partial			; not on a sector boundary
+	ld	bc,512
+	sbc	hl,bc
+	jr	c,.partial			; less than a sector left
+	add	hl,bc
+	dec	sp
+	push	hl
+	inc	sp
+	pop	bc				; b = len bits 16-23, c = len bits 8-15
+	srl	b
+	rr	c
+	ld	a,b
+	or	a,a
+	ld	a,c
+	jr	z,.sectors
+	ld	a,255
+.sectors:
+	ld	c,a
+	push	bc
+	ld	hl,(.buffer)
+	push	hl
+	ld	a,(.fd)
+	ld	c,a
+	push	bc
+	ld	a,(.write)
+	or	a,a
+	jr	z,.readsectors
+	call	fat_WriteSectors
+	jr	.sectorsdone
+.readsectors:
+	call	fat_ReadSectors
+.sectorsdone:
+	pop	bc
+	pop	bc
+	pop	bc
+	or	a,a
+	jq	z,.finish			; end of cluster chain
+	sbc	hl,hl
+	ld	h,a
+	add	hl,hl				; bytes = sectors * 512
+	jq	.advance
+.partial:
+	ld	hl,(iy + 10)
+	ld	e,(iy + 13)
+	call	__lcmpzero			; if (!desc->current_cluster) break
+	jq	z,.finish
+	push	de
+	push	hl
+	call	fat.cluster2sector
+	pop	bc
+	pop	bc
+	ld	iy,(.desc)
+	ld	a,(iy + 15)
+	rrca
+	and	a,$7f
+	ld	c,a
+	ld	a,(_fat_state + 1)
+	dec	a
+	and	a,c
+	ld	bc,0
+	ld	c,a
+	add	hl,bc
+	ld	a,e
+	adc	a,b
+	ld	e,a				; sector = cluster_to_sector(current_cluster) + ((fpos >> 9) % cluster_size)
+	push	de
+	push	hl
+	or	a,a
+	sbc	hl,hl
+	ld	a,(iy + 15)
+	and	a,1
+	ld	h,a
+	ld	l,(iy + 14)
+	ld	(.offset),hl			; offset = fpos % 512
+	ex	de,hl
+	ld	hl,512
+	or	a,a
+	sbc	hl,de
+	ld	de,(.len)
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	jr	c,.chunk
+	ex	de,hl
+.chunk:
+	ld	(.chunk),hl			; chunk = min(512 - offset, len)
+	pop	hl
+	pop	de
+	ld	a,(.write)
+	or	a,a
+	jr	nz,.partialwrite
+	call	fat.sectorptr
+	ld	de,(.offset)
+	add	hl,de
+	ld	de,(.buffer)
+	ld	bc,(.chunk)
+	ldir
+	jr	.partialdone
+.partialwrite:
+	ld	a,(cache.entries)
+	or	a,a
+	jr	z,.uncachedwrite
+	call	cache.load			; modify the sector in the cache
+	set	bCacheDirty,(iy + cacheFlags)
+	call	.copyin
+	jr	.partialdone
+.uncachedwrite:
+	push	hl
+	push	de
+	call	fat.readsector
+	ld	hl,(fat.sectorbuffer)
+	call	.copyin
+	pop	de
+	pop	hl
+	call	fat.writesector
+.partialdone:
+	ld	iy,(.desc)
+	ld	hl,(iy + 14)
+	ld	de,(.chunk)
+	add	hl,de
+	ld	(iy + 14),hl			; desc->fpos += chunk
+	jr	nc,.nocarry
+	inc	(iy + 17)
+.nocarry:
+	ld	a,(.write)
+	or	a,a
+	jr	z,.checkcluster
+	ld	hl,(iy + 14)
+	ld	e,(iy + 17)
+	ld	bc,(iy + 18)
+	ld	a,(iy + 21)
+	call	__lcmpu				; if (desc->fpos > desc->file_size)
+	jr	z,.checkcluster
+	jr	c,.checkcluster
+	ld	(iy + 18),hl
+	ld	(iy + 21),e			; desc->file_size = desc->fpos
+	ld	a,1
+	ld	(.grown),a
+.checkcluster:
+	ld	a,(iy + 14)
+	or	a,a
+	jr	nz,.nextchunk
+	ld	a,(iy + 15)
+	bit	0,a
+	jr	nz,.nextchunk			; not on a sector boundary
+	rrca
+	and	a,$7f
+	ld	c,a
+	ld	a,(_fat_state + 1)
+	dec	a
+	and	a,c
+	jr	nz,.nextchunk			; not on a cluster boundary
+	ld	(fat.xfersectors.desc),iy
+	ld	a,(.write)
+	ld	(fat.xfersectors.write),a
+	call	fat.xfersectors.nextcluster
+.nextchunk:
+	ld	hl,(.chunk)
+.advance:
+; hl = number of bytes transferred
+	ex	de,hl
+	ld	hl,(.buffer)
+	add	hl,de
+	ld	(.buffer),hl			; buffer += bytes
+	ld	hl,(.done)
+	add	hl,de
+	ld	(.done),hl			; done += bytes
+	ld	hl,(.len)
+	or	a,a
+	sbc	hl,de
+	ld	(.len),hl			; len -= bytes
+	jq	.loop
+.finish:
+	ld	a,(.grown)
+	or	a,a
+	ld	iy,(.desc)
+	call	nz,fat.updatesize
+.return:
+	ld	hl,(.done)
+	ret
+
+.copyin:
+; hl -> sector data
+	ld	de,(.offset)
+	add	hl,de
+	ex	de,hl
+	ld	hl,(.buffer)
+	ld	bc,(.chunk)
+	ldir
+	ret
+
+.desc:
+	dl	0
+.buffer:
+	dl	0
+.len:
+	dl	0
+.done:
+	dl	0
+.offset:
+	dl	0
+.chunk:
+	dl	0
+.fd:
+	db	0
+.write:
+	db	0
+.grown:
+	db	0
+
 ;-------------------------------------------------------------------------------
 fat_Init:
 	ld	b,3				; for i < max_fd_open
@@ -231,6 +919,9 @@ fat_Init:
 	ld	(_fat_state + 20),hl
 	ld	(_fat_state + 23),a
 
+	call	fat.resetfree
+	call	fat.pathflush
+	ld	iy,(fat.sectorbuffer)
 	ld	a,(_fat_state + 24)		; if fat32
 	or	a,a
 	jp	z,.done
@@ -270,7 +961,15 @@ fat_Init:
 	add	hl,bc
 	call	fat.checksectormagic
 	jr	nz,.done
-	ld	bc,488				; sect[488] = 0xffffffff
+	ld	hl,(.fsinfo)
+	ld	(fat.fsinfo),hl
+	ld	bc,488
+	lea	hl,iy
+	add	hl,bc
+	ld	de,fat.freecount
+	ld	bc,8
+	ldir					; free count = sect[488], next free = sect[492]
+	ld	bc,488				; sect[488] = 0xffffffff until unmounted
 	lea	hl,iy
 	add	hl,bc
 	ld	a,255
@@ -293,7 +992,9 @@ fat_Init:
 
 ;-------------------------------------------------------------------------------
 fat_Deinit:
-	ret
+	call	fat.syncfsinfo
+	call	cache.flush
+	jp	cache.invalidate
 
 ;-------------------------------------------------------------------------------
 fat_Find:
@@ -322,6 +1023,9 @@ fat.partitionnum := $ - 1
 
 ;-------------------------------------------------------------------------------
 fat_Select:
+	call	fat.syncfsinfo
+	call	cache.flush			; write back using the old partition
+	call	cache.invalidate
 	ld	iy,0
 	add	iy,sp
 	ld	e,(iy + 6)
@@ -340,16 +1044,33 @@ fat_Select:
 
 ;-------------------------------------------------------------------------------
 fat_Open:
-	jp	_fat_open
-
-;-------------------------------------------------------------------------------
-fat_Close:
-	pop	de
-	ex	(sp),hl
-	push	de
-	call	fat.findfd
-	ld	(hl),-1				; fat_fd[i].key = -1;
-	ret
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 6)
+	push	hl
+	ld	hl,(iy + 3)
+	push	hl
+	call	_fat_open
+	pop	hl
+	pop	hl
+	or	a,a
+	ret	m
+	push	af
+	ld	l,a
+	call	fat.findfd
+	call	fat.getmap
+	ld	(hl),0				; extent map is built on first seek
+	pop	af
+	ret
+
+;-------------------------------------------------------------------------------
+fat_Close:
+	pop	de
+	ex	(sp),hl
+	push	de
+	call	fat.findfd
+	ld	(hl),-1				; fat_fd[i].key = -1;
+	jp	cache.flush
 
 ;-------------------------------------------------------------------------------
 fat_GetFileSize:
@@ -397,10 +1118,330 @@ fat_SetBuffer:
 
 ;-------------------------------------------------------------------------------
 fat_Seek:
-	jp  _fat_seek
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 6)
+	ld	a,(iy + 9)
+	ld	(.pos),hl
+	ld	(.pos + 3),a
+	ld	l,(iy + 3)
+	call	fat.findfd
+	ld	(.desc),iy
+	ld	hl,(iy + 10)
+	ld	e,(iy + 13)
+	call	__lcmpzero			; if (!desc->current_cluster) return false
+	jq	z,.fail
+	ld	a,(iy + 22)
+	or	a,a
+	jr	nz,.index
+	ld	hl,(.pos)
+	ld	a,(.pos + 3)
+	ld	e,a
+	ld	bc,(iy + 18)
+	ld	a,(iy + 21)
+	call	__lcmpu				; if (pos >= desc->file_size && !desc->write)
+	jr	c,.index
+	ld	(.pos),bc
+	ld	(.pos + 3),a
+	ld	hl,.pos
+	ld	(hl),0
+	inc	hl
+	res	0,(hl)				; pos = desc->file_size & ~0x1ff
+.index:
+	ld	hl,(.pos)
+	ld	a,(.pos + 3)
+	ld	e,a
+	call	fat.clusterindex
+	ld	(.target),hl
+	ld	iy,(.desc)
+	ld	hl,(iy + 14)
+	ld	e,(iy + 17)
+	call	fat.clusterindex
+	ld	de,(.target)
+	or	a,a
+	sbc	hl,de
+	jr	z,.done				; still in the current cluster
+	ex	de,hl
+	ld	iy,(.desc)
+	call	fat.mapcluster
+	call	__lcmpzero
+	jq	z,.fail
+	ld	iy,(.desc)
+	ld	(iy + 10),hl
+	ld	(iy + 13),e			; desc->current_cluster = cluster
+.done:
+	ld	iy,(.desc)
+	ld	hl,(.pos)
+	ld	a,(.pos + 3)
+	ld	(iy + 14),hl
+	ld	(iy + 17),a			; desc->fpos = pos
+	ld	a,1
+	ret
+.fail:
+	xor	a,a
+	ret
+.pos:
+	dd	0
+.target:
+	dl	0
+.desc:
+	dl	0
+
+;-------------------------------------------------------------------------------
+fat.clusterindex:
+; euhl = byte offset in file
+; returns hl = cluster index in file
+	ld	a,(_fat_state + 1)
+	ld	d,9
+.log2:
+	rrca
+	jr	c,.shift
+	inc	d
+	jr	.log2
+.shift:
+	push	hl
+	pop	bc
+	ld	a,e
+	ld	l,d
+	call	__lshru				; offset >> (9 + log2(cluster_size))
+	push	bc
+	pop	hl
+	ret
+
+;-------------------------------------------------------------------------------
+fat.getmap:
+; iy -> file descriptor
+; returns hl -> extent map of descriptor
+	lea	hl,iy
+	ld	de,_fat_fd
+	or	a,a
+	sbc	hl,de
+	ld	a,l
+	ld	hl,fat.maps
+	ld	de,mapSize
+.find:
+	sub	a,FD_SIZE
+	ret	c
+	add	hl,de
+	jr	.find
+
+;-------------------------------------------------------------------------------
+fat.mapcluster:
+; maps a file cluster index to a cluster using the extent map, following the
+; cluster chain past the end of the map and recording new runs as it goes
+; iy -> file descriptor
+; hl = cluster index in file
+; returns euhl = cluster, 0 if past the end of the chain and not writing
+	ld	(.target),hl
+	ld	(.desc),iy
+	ld	hl,(iy + 6)
+	ld	a,(iy + 9)
+	ld	(.cluster),hl
+	ld	(.cluster + 3),a
+	call	fat.getmap
+	push	hl
+	pop	iy
+	ld	(.map),iy
+	ld	a,(iy + mapCount)
+	or	a,a
+	jr	nz,.built
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	(iy + mapExtents + extCluster),hl
+	ld	(iy + mapExtents + extCluster + 3),a
+	ld	(iy + mapLast),hl
+	ld	(iy + mapLast + 3),a
+	or	a,a
+	sbc	hl,hl
+	ld	(iy + mapExtents + extIndex),hl
+	ld	(iy + mapIndex),hl
+	ld	(iy + mapCount),1		; first run starts at the first cluster
+.built:
+	ld	hl,(.target)
+	ld	de,(iy + mapIndex)
+	or	a,a
+	sbc	hl,de
+	jq	c,.search
+	jq	z,.search
+	ld	(.remaining),hl
+	ld	hl,(iy + mapLast)
+	ld	a,(iy + mapLast + 3)
+	ld	(.cluster),hl
+	ld	(.cluster + 3),a
+	xor	a,a
+	ld	(.full),a
+.walk:
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	e,a
+	push	de
+	push	hl
+	call	fat.nextcluster
+	pop	bc
+	pop	bc
+	call	__lcmpzero
+	jr	nz,.next
+	ld	iy,(.desc)
+	ld	a,(iy + 22)			; end of chain, extend if writing
+	or	a,a
+	ret	z
+	ld	a,(.cluster + 3)
+	ld	c,a
+	ld	b,0
+	push	bc
+	ld	bc,(.cluster)
+	push	bc
+	ld	c,(iy + 5)
+	push	bc
+	ld	c,(iy + 4)
+	push	bc
+	ld	bc,(iy + 1)
+	push	bc
+	call	fat.alloc_cluster		; alloc_cluster(entry_sector, entry_index, cluster)
+	pop	bc, bc, bc, bc, bc
+	call	__lcmpzero
+	ret	z
+.next:
+	push	hl
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	bc,1
+	add	hl,bc
+	adc	a,b
+	push	hl
+	pop	bc
+	pop	hl
+	call	__lcmpu				; z if next == cluster + 1
+	ld	(.cluster),hl
+	ld	a,e
+	ld	(.cluster + 3),a
+	ld	iy,(.map)
+	ld	a,(.full)
+	jr	z,.contiguous
+	or	a,a
+	jr	nz,.count
+	ld	a,(iy + mapCount)
+	cp	a,FAT_EXTENT_MAX
+	jr	c,.add
+	ld	(.full),a			; stop recording, the map is full
+	jr	.count
+.add:
+	ld	d,a
+	ld	e,extSize
+	mlt	de
+	inc	a
+	ld	(iy + mapCount),a
+	lea	hl,iy + mapExtents
+	add	hl,de
+	ld	de,(iy + mapIndex)
+	inc	de
+	ld	(hl),de				; run starts after the last mapped cluster
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(.cluster)
+	ld	(hl),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	a,(.cluster + 3)
+	ld	(hl),a
+	jr	.record
+.contiguous:
+	or	a,a
+	jr	nz,.count
+.record:
+	ld	hl,(iy + mapIndex)
+	inc	hl
+	ld	(iy + mapIndex),hl
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	(iy + mapLast),hl
+	ld	(iy + mapLast + 3),a
+.count:
+	ld	hl,(.remaining)
+	dec	hl
+	ld	(.remaining),hl
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jq	nz,.walk
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	e,a
+	ret
+.search:
+	ld	b,(iy + mapCount)
+	ld	c,0				; binary search for the last run starting at or before target
+.bisect:
+	ld	a,b
+	cp	a,2
+	jr	c,.found
+	srl	a
+	ld	d,a
+	add	a,c
+	ld	e,a				; d = half, e = middle
+	push	de
+	ld	d,extSize
+	mlt	de
+	lea	hl,iy + mapExtents
+	add	hl,de
+	ld	de,(hl)
+	ld	hl,(.target)
+	or	a,a
+	sbc	hl,de
+	pop	de
+	jr	c,.lower
+	ld	c,e				; first = middle
+	ld	a,b
+	sub	a,d
+	ld	b,a
+	jr	.bisect
+.lower:
+	ld	b,d
+	jr	.bisect
+.found:
+	ld	d,c
+	ld	e,extSize
+	mlt	de
+	lea	hl,iy + mapExtents
+	add	hl,de
+	push	hl
+	ld	de,(hl)
+	ld	hl,(.target)
+	or	a,a
+	sbc	hl,de
+	ex	de,hl				; de = target - run index
+	pop	hl
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	bc,(hl)
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	a,(hl)
+	ex	de,hl
+	add	hl,bc
+	adc	a,0
+	ld	e,a				; cluster = run cluster + (target - run index)
+	ret
+.target:
+	dl	0
+.remaining:
+	dl	0
+.desc:
+	dl	0
+.map:
+	dl	0
+.cluster:
+	dd	0
+.full:
+	db	0
 
 ;-------------------------------------------------------------------------------
 fat_Delete:
+	call	fat.pathflush			; the path may be a remembered directory
 	jp	_delete_file
 
 ;-------------------------------------------------------------------------------
@@ -433,6 +1474,1025 @@ fat_SetAttrib:
 fat_DirList:
 	jp	_fat_dirlist
 
+;-------------------------------------------------------------------------------
+fat_OpenDir:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 3)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.root				; null path is the root directory
+.slash:
+	ld	a,(hl)
+	inc	hl
+	cp	a,'/'
+	jr	z,.slash
+	or	a,a
+	jr	z,.root
+	call	fat.locate
+	jr	z,.fail
+	ld	bc,11
+	add	hl,bc
+	bit	4,(hl)				; if (!(sector_buff[index * 32 + 11] & 0x10))
+	jr	z,.fail
+	ld	hl,(fat.locate.index)
+	call	fat.getentrycluster.asm		; cluster 0 refers to the root directory
+	jr	.init
+.root:
+	or	a,a
+	sbc	hl,hl
+	ld	e,l
+.init:
+	ld	iy,0
+	add	iy,sp
+	ld	iy,(iy + 6)
+	ld	(iy + dirFirst),hl
+	ld	(iy + dirFirst + 3),e
+	call	fat.rewinddir
+	ld	a,1
+	ret
+.fail:
+	xor	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+fat_RewindDir:
+	pop	de
+	ex	(sp),hl
+	push	de
+	push	hl
+	pop	iy
+;	jr	fat.rewinddir
+
+;-------------------------------------------------------------------------------
+fat.rewinddir:
+; iy -> directory handle
+	ld	hl,(iy + dirFirst)
+	ld	e,(iy + dirFirst + 3)
+	call	__lcmpzero
+	jr	nz,.cluster
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	nz,.root32
+	ld	(iy + dirCluster),hl
+	ld	(iy + dirCluster + 3),a
+	ld	hl,(_fat_state + 16)
+	ld	a,(_fat_state + 19)
+	ld	(iy + dirSector),hl
+	ld	(iy + dirSector + 3),a
+	ld	hl,(_fat_state + 2)
+	srl	h
+	rr	l
+	srl	h
+	rr	l
+	srl	h
+	rr	l
+	srl	h
+	rr	l				; fat_state.root_directory_size * 32 / 512
+	ld	(iy + dirLeft),l
+	ld	(iy + dirLeft + 1),h
+	jr	.index
+.root32:
+	ld	hl,(_fat_state + 16)
+	ld	a,(_fat_state + 19)
+	ld	e,a
+	push	iy
+	push	de
+	push	hl
+	call	fat.sector2cluster
+	pop	bc
+	pop	bc
+	pop	iy
+.cluster:
+	ld	(iy + dirCluster),hl
+	ld	(iy + dirCluster + 3),e
+	push	de
+	push	hl
+	call	fat.cluster2sector
+	pop	bc
+	pop	bc
+	ld	(iy + dirSector),hl
+	ld	(iy + dirSector + 3),e
+	ld	a,(_fat_state + 1)
+	ld	(iy + dirLeft),a
+	ld	(iy + dirLeft + 1),0
+.index:
+	ld	(iy + dirIndex),0
+	ret
+
+;-------------------------------------------------------------------------------
+fat_ReadDir:
+	ld	iy,0
+	add	iy,sp
+	ld	de,(iy + 6)
+	ld	iy,(iy + 3)
+	push	de
+	call	fat.dirnextvalid
+	pop	de
+	jr	z,.end
+	call	fat.direntry
+	ld	a,1
+	ret
+.end:
+	xor	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+fat_ReadDirLong:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 9)
+	ld	(fat.lfn.buffer),hl
+	ld	de,(iy + 6)
+	ld	iy,(iy + 3)
+	xor	a,a
+	ld	(fat.lfn.mode),a
+	push	de
+	call	fat.dirnextlong
+	pop	de
+	jr	z,.end
+	push	de
+	call	fat.direntry
+	pop	hl
+	ld	a,(fat.lfn.valid)
+	or	a,a
+	jr	nz,.long
+	ld	de,(fat.lfn.buffer)
+	ld	bc,13
+	ldir					; no long name, use the 8.3 name
+.long:
+	ld	a,1
+	ret
+.end:
+	xor	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+fat_FindEntry:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 6)
+	ld	b,0
+.length:
+	ld	a,(hl)
+	or	a,a
+	jr	z,.measured
+	inc	hl
+	inc	b
+	jr	nz,.length
+	jr	.fail				; longer than any name
+.measured:
+	ld	a,b
+	or	a,a
+	jr	z,.fail
+	ld	hl,(iy + 6)
+	ld	iy,(iy + 3)
+	push	bc
+	push	hl
+	call	fat.rewinddir
+	pop	hl
+	pop	bc
+	call	fat.dirfind
+	jr	z,.fail
+	ld	iy,0
+	add	iy,sp
+	ld	de,(iy + 9)
+	call	fat.direntry
+	ld	a,1
+	ret
+.fail:
+	xor	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+_locate_record:
+; uint32_t locate_record(const char *path, unsigned int *record_index, const char *tail)
+; resolves a path one component at a time, matching long or 8.3 names
+; returns the sector holding the entry, 0 if not found
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy + 6)
+	ld	(.indexptr),hl
+	ld	de,(iy + 9)
+	ld	(.tail),de
+	ld	hl,(iy + 3)
+	ld	(.path),hl
+	call	fat.pathfind			; start from a remembered directory
+	jr	z,.root
+	ld	(.path),bc
+	jr	.start
+.root:
+	or	a,a
+	sbc	hl,hl
+	ld	e,l
+.start:
+	ld	(.cluster),hl
+	ld	a,e
+	ld	(.cluster + 3),a
+	xor	a,a
+	ld	(.found),a
+	ld	(.file),a
+.component:
+	ld	hl,(.path)
+.slash:
+	ld	a,(hl)
+	cp	a,'/'
+	jr	nz,.skipped
+	inc	hl
+	jr	.slash
+.skipped:
+	ld	(.path),hl
+	or	a,a
+	jr	nz,.search
+	ld	hl,(.tail)			; end of path, continue with tail
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.end
+	ld	(.path),hl
+	xor	a,a
+	ld	(fat.pathactive),a		; tail is not part of the path
+	sbc	hl,hl
+	ld	(.tail),hl
+	jq	.component
+.end:
+	ld	a,(.found)
+	or	a,a
+	jq	z,.fail
+	ld	hl,(.indexptr)
+	ld	de,0
+	ld	a,(.index)
+	ld	e,a
+	ld	(hl),de				; *record_index = i
+	ld	hl,(.sector)
+	ld	a,(.sector + 3)
+	ld	e,a
+	ret
+.fail:
+	xor	a,a
+	sbc	hl,hl
+	ld	e,a
+	ret
+.search:
+	ld	a,(.file)
+	or	a,a
+	jq	nz,.fail			; a non-directory mid-path
+	ld	b,0
+.length:
+	inc	hl
+	inc	b
+	jq	z,.fail
+	ld	a,(hl)
+	or	a,a
+	jr	z,.measured
+	cp	a,'/'
+	jr	nz,.length
+.measured:
+	ld	(.next),hl
+	push	bc
+	ld	iy,.dir
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	(iy + dirFirst),hl
+	ld	(iy + dirFirst + 3),a
+	call	fat.rewinddir
+	pop	bc
+	ld	hl,(.path)
+	call	fat.dirfind
+	jq	z,.fail
+	ld	a,(iy + dirIndex)
+	dec	a
+	ld	(.index),a
+	ld	de,(iy + dirSector)
+	ld	(.sector),de
+	ld	a,(iy + dirSector + 3)
+	ld	(.sector + 3),a
+	push	hl
+	ld	bc,11
+	add	hl,bc
+	ld	a,(hl)
+	pop	hl
+	and	a,$10
+	xor	a,$10
+	ld	(.file),a
+	ld	a,1
+	ld	(.found),a
+	call	fat.entrycluster
+	ld	(.cluster),hl
+	ld	a,e
+	ld	(.cluster + 3),a
+	ld	bc,(.next)
+	ld	(.path),bc
+	ld	a,(.file)
+	or	a,a
+	jq	nz,.component
+	ld	a,(bc)
+	or	a,a
+	jq	z,.component
+	inc	bc
+	call	fat.pathadd			; remember the directory
+	jq	.component
+
+.path:
+	dl	0
+.next:
+	dl	0
+.tail:
+	dl	0
+.indexptr:
+	dl	0
+.cluster:
+	dd	0
+.sector:
+	dd	0
+.index:
+	db	0
+.found:
+	db	0
+.file:
+	db	0
+.dir:
+	rb	16
+
+;-------------------------------------------------------------------------------
+fat.entrycluster:
+; hl -> raw directory entry
+; returns euhl = first cluster of entry
+	ld	bc,20
+	add	hl,bc
+	ld	c,(hl)
+	inc	hl
+	ld	b,(hl)
+	ld	de,5
+	add	hl,de
+	ld	de,(hl)
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	nz,.fat32
+	ld	bc,0				; fat16 only uses the low word
+.fat32:
+	ld	(.cluster),de
+	ld	a,c
+	ld	(.cluster + 2),a
+	ld	hl,0
+.cluster := $ - 3
+	ld	e,b
+	ret
+
+;-------------------------------------------------------------------------------
+fat.dirfind:
+; iy -> directory handle
+; hl -> name, terminated by null or '/'
+; b = length of name
+; returns hl -> matching entry, z if not found
+	ld	(fat.lfn.name),hl
+	ld	a,b
+	ld	(fat.lfn.length),a
+	ld	a,1
+	ld	(fat.lfn.mode),a
+	xor	a,a
+	ld	(.short),a
+	ld	a,b
+	cp	a,13
+	jr	nc,.scan			; too long to be an 8.3 name
+	ld	de,.component
+	ld	bc,0
+	ld	c,a
+	ldir
+	xor	a,a
+	ld	(de),a
+	ld	hl,.component
+	ld	c,a
+.base:
+	ld	a,(hl)
+	or	a,a
+	jr	z,.based
+	cp	a,'.'
+	jr	z,.based
+	inc	hl
+	inc	c
+	jr	.base
+.based:
+	ld	a,c
+	cp	a,9
+	jr	nc,.scan
+	ld	a,(fat.lfn.length)
+	sub	a,c
+	cp	a,5
+	jr	nc,.scan			; more than 3 characters of extension
+	push	iy
+	ld	hl,.fatname
+	push	hl
+	ld	hl,.component
+	push	hl
+	call	fat.fname2fatname		; fname_to_fatname(component, fatname)
+	pop	hl
+	pop	hl
+	pop	iy
+	ld	a,1
+	ld	(.short),a
+.scan:
+	call	fat.dirnextlong
+	ret	z
+	ld	a,(fat.lfn.valid)
+	or	a,a
+	ret	nz				; long name matches
+	ld	a,(.short)
+	or	a,a
+	jr	z,.scan
+	push	hl
+	ld	de,.fatname
+	ld	b,11
+.compare:
+	ld	a,(de)
+	call	fat.lower
+	ld	c,a
+	ld	a,(hl)
+	call	fat.lower
+	cp	a,c
+	jr	nz,.differ
+	inc	hl
+	inc	de
+	djnz	.compare
+.differ:
+	pop	hl
+	jr	nz,.scan
+	or	a,1
+	ret
+.short:
+	db	0
+.component:
+	rb	13
+.fatname:
+	rb	11
+
+;-------------------------------------------------------------------------------
+fat.lower:
+	cp	a,'A'
+	ret	c
+	cp	a,'Z' + 1
+	ret	nc
+	or	a,$20
+	ret
+
+;-------------------------------------------------------------------------------
+fat.dirnextlong:
+; iy -> directory handle
+; returns hl -> next short entry that is not deleted, z if none
+; long name entries before it are assembled into fat.lfn.buffer, or matched
+; against fat.lfn.name, while they are read. fat.lfn.valid is nonzero if the
+; long name belongs to the entry and, when matching, equals the name.
+	xor	a,a
+	ld	(fat.lfn.valid),a
+.next:
+	call	fat.dirnext
+	ret	z
+	ld	a,(hl)
+	cp	a,$e5
+	jr	z,fat.dirnextlong		; deleted record
+	push	hl
+	ld	bc,11
+	add	hl,bc
+	ld	a,(hl)
+	pop	hl
+	cp	a,$0f
+	jr	z,.long
+	ld	a,(fat.lfn.valid)
+	or	a,a
+	jr	z,.short
+	ld	a,(fat.lfn.ord)
+	or	a,a
+	jr	nz,.orphan			; missing long name entries
+	push	hl
+	ld	b,11
+.sum:
+	rrca
+	add	a,(hl)
+	inc	hl
+	djnz	.sum
+	pop	hl
+	ld	c,a
+	ld	a,(fat.lfn.sum)
+	cp	a,c
+	jr	z,.short
+.orphan:
+	xor	a,a
+	ld	(fat.lfn.valid),a
+.short:
+	or	a,1
+	ret
+.long:
+	ld	a,(hl)
+	bit	6,a
+	jr	z,.part
+	and	a,$1f				; last entry of a long name comes first
+	jr	z,.reject
+	cp	a,FAT_LFN_MAX + 1
+	jr	nc,.reject
+	ld	(fat.lfn.ord),a
+	ld	d,a
+	ld	e,13
+	mlt	de				; de = maximum length of long name
+	ld	a,(fat.lfn.mode)
+	or	a,a
+	jr	z,.terminate
+	push	hl
+	or	a,a
+	sbc	hl,hl
+	ld	a,(fat.lfn.length)
+	ld	l,a
+	ex	de,hl
+	or	a,a
+	sbc	hl,de
+	jr	c,.mismatch			; name is too long
+	ld	bc,13
+	sbc	hl,bc
+	pop	hl
+	jr	nc,.reject			; name is too short
+	jr	.accept
+.mismatch:
+	pop	hl
+	jr	.reject
+.terminate:
+	ld	a,d
+	or	a,a
+	jr	z,.terminator
+	ld	de,255
+.terminator:
+	push	hl
+	ld	hl,(fat.lfn.buffer)
+	add	hl,de
+	ld	(hl),0
+	pop	hl
+.accept:
+	push	hl
+	ld	bc,13
+	add	hl,bc
+	ld	a,(hl)
+	pop	hl
+	ld	(fat.lfn.sum),a
+	ld	a,1
+	ld	(fat.lfn.valid),a
+	jr	.chars
+.part:
+	ld	a,(fat.lfn.valid)
+	or	a,a
+	jq	z,.next
+	ld	a,(fat.lfn.ord)
+	or	a,a
+	jr	z,.reject
+	cp	a,(hl)
+	jr	nz,.reject			; out of sequence
+	push	hl
+	ld	bc,13
+	add	hl,bc
+	ld	a,(fat.lfn.sum)
+	cp	a,(hl)
+	pop	hl
+	jr	z,.chars
+.reject:
+	xor	a,a
+	ld	(fat.lfn.valid),a		; checksum, sequence, or length mismatch
+	jq	.next
+.chars:
+	call	.stage
+	ld	a,(fat.lfn.ord)
+	dec	a
+	ld	(fat.lfn.ord),a
+	ld	d,a
+	ld	e,13
+	mlt	de				; de = position of characters in name
+	ld	a,(fat.lfn.mode)
+	or	a,a
+	jr	nz,.match
+	ld	c,e
+	ld	hl,(fat.lfn.buffer)
+	add	hl,de
+	ex	de,hl
+	ld	hl,fat.lfn.stage
+	ld	b,13
+.copy:
+	ld	a,c
+	inc	a
+	jq	z,.next				; keep room for the terminator
+	ld	a,(hl)
+	ld	(de),a
+	or	a,a
+	jq	z,.next
+	inc	hl
+	inc	de
+	inc	c
+	djnz	.copy
+	jq	.next
+.match:
+	ld	hl,(fat.lfn.name)
+	add	hl,de
+	ld	a,(fat.lfn.length)
+	sub	a,e
+	ld	c,a				; c = characters left in name
+	ld	de,fat.lfn.stage
+	ld	b,13
+.matchchar:
+	ld	a,c
+	or	a,a
+	jr	z,.matchend
+	push	bc
+	ld	a,(hl)
+	call	fat.lower
+	ld	b,a
+	ld	a,(de)
+	call	fat.lower
+	cp	a,b
+	pop	bc
+	jr	nz,.reject
+	inc	hl
+	inc	de
+	dec	c
+	djnz	.matchchar
+	jq	.next
+.matchend:
+	ld	a,(de)
+	or	a,a
+	jq	z,.next
+	jr	.reject
+
+; hl -> long name entry
+; converts the 13 ucs-2 characters of the entry to fat.lfn.stage
+; characters outside ascii become '?', padding becomes $ff
+.stage:
+	push	hl
+	ld	de,fat.lfn.stage
+	inc	hl
+	ld	b,5
+	call	.convert
+	ld	bc,3
+	add	hl,bc
+	ld	b,6
+	call	.convert
+	inc	hl
+	inc	hl
+	ld	b,2
+	call	.convert
+	pop	hl
+	ret
+.convert:
+	ld	c,(hl)
+	inc	hl
+	ld	a,(hl)
+	inc	hl
+	or	a,a
+	jr	nz,.wide
+	ld	a,c
+	cp	a,$80
+	jr	c,.store
+	ld	a,'?'
+	jr	.store
+.wide:
+	and	a,c
+	inc	a
+	ld	a,$ff
+	jr	z,.store
+	ld	a,'?'
+.store:
+	ld	(de),a
+	inc	de
+	djnz	.convert
+	ret
+
+;-------------------------------------------------------------------------------
+fat.dirnext:
+; iy -> directory handle
+; returns hl -> next raw directory entry, z if the end of the directory
+	ld	a,(iy + dirIndex)
+	cp	a,16
+	jr	c,.read
+	ld	l,(iy + dirLeft)
+	ld	h,(iy + dirLeft + 1)
+	dec	hl
+	ld	a,h
+	or	a,l
+	jr	z,.nextcluster
+	ld	(iy + dirLeft),l
+	ld	(iy + dirLeft + 1),h
+	ld	hl,(iy + dirSector)
+	ld	e,(iy + dirSector + 3)
+	ld	bc,1
+	xor	a,a
+	call	__ladd
+	jr	.sector
+.nextcluster:
+	ld	hl,(iy + dirCluster)
+	ld	e,(iy + dirCluster + 3)
+	call	__lcmpzero
+	ret	z				; end of a fixed size root directory
+	push	de
+	push	hl
+	call	fat.nextcluster
+	pop	bc
+	pop	bc
+	call	__lcmpzero
+	ret	z				; end of the cluster chain
+	ld	(iy + dirCluster),hl
+	ld	(iy + dirCluster + 3),e
+	push	de
+	push	hl
+	call	fat.cluster2sector
+	pop	bc
+	pop	bc
+	ld	a,(_fat_state + 1)
+	ld	(iy + dirLeft),a
+	ld	(iy + dirLeft + 1),0
+.sector:
+	ld	(iy + dirSector),hl
+	ld	(iy + dirSector + 3),e
+	ld	(iy + dirIndex),0
+.read:
+	ld	hl,(iy + dirSector)
+	ld	e,(iy + dirSector + 3)
+	call	fat.sectorptr
+	ld	d,(iy + dirIndex)
+	ld	e,32
+	mlt	de
+	add	hl,de
+	ld	a,(hl)
+	or	a,a
+	ret	z				; end of list
+	inc	(iy + dirIndex)
+	ret
+
+;-------------------------------------------------------------------------------
+fat.dirnextvalid:
+; iy -> directory handle
+; returns hl -> next entry that is not deleted or a long name, z if none
+	call	fat.dirnext
+	ret	z
+	ld	a,(hl)
+	cp	a,$e5
+	jr	z,fat.dirnextvalid		; deleted record
+	push	hl
+	ld	bc,11
+	add	hl,bc
+	ld	a,(hl)
+	pop	hl
+	cp	a,$0f
+	jr	z,fat.dirnextvalid		; long filename entry
+	ret
+
+;-------------------------------------------------------------------------------
+fat.direntry:
+; hl -> raw directory entry
+; de -> fat_entry_t to fill
+	push	de
+	push	hl
+	ld	b,8
+.name:
+	ld	a,(hl)
+	cp	a,' '
+	jr	z,.ext
+	ld	(de),a
+	inc	hl
+	inc	de
+	djnz	.name
+.ext:
+	pop	hl
+	push	hl
+	ld	bc,8
+	add	hl,bc
+	ld	a,(hl)
+	cp	a,' '
+	jr	z,.done
+	ld	a,'.'
+	ld	(de),a
+	inc	de
+	ld	b,3
+.extension:
+	ld	a,(hl)
+	cp	a,' '
+	jr	z,.done
+	ld	(de),a
+	inc	hl
+	inc	de
+	djnz	.extension
+.done:
+	xor	a,a
+	ld	(de),a				; filename[k] = 0
+	pop	hl
+	pop	de
+	ld	bc,11
+	add	hl,bc
+	ld	a,(hl)
+	ex	de,hl
+	ld	bc,13
+	add	hl,bc
+	ld	(hl),a				; attrib = sector_buff[j * 32 + 11]
+	ret
+
+;-------------------------------------------------------------------------------
+fat.pathflush:
+; forgets all remembered directories
+	ld	hl,fat.paths + pathLen
+	ld	de,pathSize
+	ld	b,FAT_PATH_CACHE_MAX
+.loop:
+	ld	(hl),0
+	add	hl,de
+	djnz	.loop
+	ret
+
+;-------------------------------------------------------------------------------
+fat.pathfind:
+; finds the longest remembered directory that prefixes a path
+; hl -> path
+; de -> tail, or null
+; returns nz, bc -> rest of path, euhl = first cluster of directory if found
+	ld	(fat.pathstart),hl
+	push	hl
+	ex	de,hl
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	ld	a,0
+	jr	nz,.tail
+	inc	a
+.tail:
+	ld	(fat.pathactive),a		; only remember prefixes of a plain path
+	pop	hl
+	xor	a,a
+	ld	(.found),a
+	ld	b,a				; b = length
+	ld	c,a				; c = hash
+.scan:
+	ld	a,(hl)
+	or	a,a
+	jr	z,.done
+	inc	hl
+	inc	b
+	ld	d,a
+	ld	a,c
+	rlca
+	xor	a,d
+	ld	c,a
+	ld	a,b
+	cp	a,FAT_PATH_MAX + 1
+	jr	nc,.done
+	ld	a,d
+	cp	a,'/'
+	jr	nz,.scan
+	push	hl
+.slash:
+	ld	a,(hl)
+	cp	a,'/'
+	jr	nz,.component
+	inc	hl
+	jr	.slash
+.component:
+	ld	(.rest),hl
+	pop	hl
+	or	a,a
+	jr	z,.done				; a directory must have something after it
+	call	.match
+	jr	nz,.scan
+	ld	de,(.rest)
+	ld	(.result),de
+	ld	de,(iy + pathCluster)
+	ld	(.sector),de
+	ld	a,(iy + pathCluster + 3)
+	ld	(.sector + 3),a
+	ld	a,1
+	ld	(.found),a
+	jr	.scan
+.done:
+	ld	a,(.found)
+	or	a,a
+	ret	z
+	ld	bc,(.result)
+	ld	hl,(.sector)
+	ld	a,(.sector + 3)
+	ld	e,a
+	ret
+
+; b = length of path prefix
+; c = hash of path prefix
+; returns z, iy -> remembered directory if found
+.match:
+	push	bc
+	push	hl
+	ld	iy,fat.paths
+	ld	a,FAT_PATH_CACHE_MAX
+.entry:
+	push	af
+	ld	a,(iy + pathLen)
+	cp	a,b
+	jr	nz,.miss
+	ld	a,(iy + pathHash)
+	cp	a,c
+	jr	nz,.miss
+	push	bc
+	lea	de,iy + pathName
+	ld	hl,(fat.pathstart)
+.compare:
+	ld	a,(de)
+	cp	a,(hl)
+	jr	nz,.differ
+	inc	de
+	inc	hl
+	djnz	.compare
+.differ:
+	pop	bc
+	jr	z,.hit
+.miss:
+	pop	af
+	lea	iy,iy + pathSize
+	dec	a
+	jr	nz,.entry
+	inc	a
+	pop	hl
+	pop	bc
+	ret
+.hit:
+	pop	af
+	pop	hl
+	pop	bc
+	xor	a,a
+	ret
+
+.found:
+	db	0
+.rest:
+	dl	0
+.result:
+	dl	0
+.sector:
+	dd	0
+
+;-------------------------------------------------------------------------------
+fat.pathadd:
+; remembers a directory resolved while locating a path
+; bc -> end of directory prefix in path
+; euhl = first cluster of directory
+	ld	a,(fat.pathactive)
+	or	a,a
+	ret	z
+	ld	(.cluster),hl
+	ld	a,e
+	ld	(.cluster + 3),a
+	push	bc
+	pop	hl
+	ld	de,(fat.pathstart)
+	or	a,a
+	sbc	hl,de
+	ret	z
+	ld	bc,FAT_PATH_MAX + 1
+	or	a,a
+	sbc	hl,bc
+	ret	nc				; too long to remember
+	add	hl,bc
+	ld	b,l
+	ex	de,hl
+	push	hl
+	push	bc
+	ld	c,0
+.hash:
+	ld	a,c
+	rlca
+	xor	a,(hl)
+	ld	c,a
+	inc	hl
+	djnz	.hash
+	ld	a,c
+	pop	bc
+	ld	c,a
+	pop	hl
+	call	fat.pathfind.match
+	jr	z,.store			; already remembered, update it
+	ld	a,(fat.pathnext)
+	ld	d,a
+	ld	e,pathSize
+	mlt	de
+	ld	iy,fat.paths
+	add	iy,de
+	inc	a
+	cp	a,FAT_PATH_CACHE_MAX
+	jr	c,.replace
+	xor	a,a
+.replace:
+	ld	(fat.pathnext),a
+	ld	(iy + pathLen),b
+	ld	(iy + pathHash),c
+	lea	de,iy + pathName
+	ld	bc,0
+	ld	c,(iy + pathLen)
+	ldir
+.store:
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	(iy + pathCluster),hl
+	ld	(iy + pathCluster + 3),a
+	ret
+.cluster:
+	dd	0
+
 ;-------------------------------------------------------------------------------
 fat.getentrycluster:
 ; return (((GET16(sector_buff + ((e) * 32 + 20)) << 16) |
@@ -694,9 +2754,8 @@ fat.nextcluster:
 	add	hl,de
 	ld	a,(_fat_state + 12 + 3)
 	ld	e,a
-	call	fat.readsector
+	call	fat.sectorptr
 	pop	de
-	ld	hl,(fat.sectorbuffer)
 	add	hl,de
 	ld	a,(_fat_state + 24)
 	or	a,a
@@ -731,6 +2790,522 @@ fat.nextcluster:
 	ld	e,a
 	ret
 
+;-------------------------------------------------------------------------------
+fat.resetfree:
+; forgets all free space information, called on mount
+	ld	hl,fat.freemap
+	ld	de,fat.freemap + 1
+	ld	bc,FAT_FREEMAP_BITS / 8 - 1
+	ld	(hl),b
+	ldir
+	scf
+	sbc	hl,hl
+	ld	(fat.freecount),hl
+	ld	a,l
+	ld	(fat.freecount + 3),a		; free count unknown
+	ld	hl,2
+	ld	(fat.nextfree),hl
+	xor	a,a
+	ld	(fat.nextfree + 3),a
+	sbc	hl,hl
+	ld	(fat.fsinfo),hl
+	ld	hl,(_fat_state + 8)
+	dec	hl
+	ld	de,FAT_FREEMAP_BITS
+	ld	c,0
+.shift:
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	jr	c,.shifted
+	ex	de,hl
+	add	hl,hl
+	ex	de,hl
+	inc	c
+	jr	.shift
+.shifted:
+	ld	a,c
+	ld	(fat.freemapshift),a
+	push	hl
+	pop	bc
+	ld	l,a
+	xor	a,a
+	call	__lshru
+	inc	bc
+	ld	(fat.freemapgroups),bc		; groups = (fat_size - 1) / group + 1
+	ld	a,(fat.freemapshift)
+	ld	b,a
+	inc	b
+	ld	hl,1
+	jr	.size
+.double:
+	add	hl,hl
+.size:
+	djnz	.double
+	ld	(fat.freemapgroup),hl
+	ret
+
+;-------------------------------------------------------------------------------
+fat.syncfsinfo:
+; writes the free count and next free hint back to the fsinfo sector
+	ld	hl,(fat.fsinfo)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	ret	z
+	ld	de,0
+	ld	(fat.fsinfo),de
+	push	hl
+	ld	e,d
+	call	fat.sectorptr
+	push	hl
+	ld	de,488
+	add	hl,de
+	ex	de,hl
+	ld	hl,fat.freecount
+	ld	bc,8
+	ldir					; sect[488] = free count, sect[492] = next free
+	pop	bc
+	pop	hl
+	ld	e,0
+	jp	fat.writesectorbc
+
+;-------------------------------------------------------------------------------
+fat.clustergroup:
+; euhl = cluster
+; returns bc = free map group containing the cluster
+	push	hl
+	pop	bc
+	ld	a,(_fat_state + 24)
+	ld	l,a
+	ld	a,(fat.freemapshift)
+	add	a,8
+	sub	a,l
+	ld	l,a
+	ld	a,e
+	jp	__lshru
+
+;-------------------------------------------------------------------------------
+fat.freemapbit:
+; bc = free map group
+; returns hl -> free map byte, a = bit mask
+	ld	a,c
+	and	a,7
+	srl	b
+	rr	c
+	srl	b
+	rr	c
+	srl	b
+	rr	c
+	ld	hl,fat.freemap
+	ld	de,0
+	ld	e,c
+	add	hl,de
+	ld	b,a
+	inc	b
+	ld	a,1
+	jr	.bit
+.mask:
+	add	a,a
+.bit:
+	djnz	.mask
+	ret
+
+;-------------------------------------------------------------------------------
+fat.freecluster:
+; euhl = cluster about to be freed
+	call	fat.clustergroup
+	call	fat.freemapbit
+	cpl
+	and	a,(hl)
+	ld	(hl),a				; the group has a free cluster again
+	ld	hl,(fat.freecount)
+	ld	a,(fat.freecount + 3)
+	ld	e,a
+	ld	bc,1
+	xor	a,a
+	call	__ladd
+	call	__lcmpzero
+	ret	z				; free count unknown
+	ld	(fat.freecount),hl
+	ld	a,e
+	ld	(fat.freecount + 3),a
+	ret
+
+;-------------------------------------------------------------------------------
+fat.alloc_cluster:
+; allocates a free cluster and links it to the end of a chain
+; arg0 = entry sector (low 24 bits)
+; arg1 = entry sector (high 8 bits)
+; arg2 = entry index
+; arg3 = old cluster (low 24 bits)
+; arg4 = old cluster (high 8 bits)
+; returns euhl = cluster, 0 if the disk is full
+; the search starts right after the old cluster so growing files stay
+; contiguous, or at the next free hint for new chains, and skips groups of
+; fat sectors already known to be full
+	call	__frameset0
+	ld	hl,(_fat_state + 4)
+	ld	a,(_fat_state + 7)
+	ld	e,a
+	ld	bc,2
+	xor	a,a
+	call	__ladd
+	ld	(.limit),hl
+	ld	a,e
+	ld	(.limit + 3),a			; limit = fatstate.clusters + 2
+	ld	hl,(ix + 15)
+	ld	e,(ix + 18)
+	call	__lcmpzero
+	jr	z,.hint
+	ld	bc,1
+	xor	a,a
+	call	__ladd				; start = old_cluster + 1
+	jr	.clamp
+.hint:
+	ld	hl,(fat.nextfree)
+	ld	a,(fat.nextfree + 3)
+	ld	e,a				; start = next free
+.clamp:
+	ld	bc,(.limit)
+	ld	a,(.limit + 3)
+	call	__lcmpu
+	jr	nc,.wrap
+	ld	bc,2
+	xor	a,a
+	call	__lcmpu
+	jr	nc,.start
+.wrap:
+	ld	hl,2
+	ld	e,0
+.start:
+	call	.locate
+	ld	hl,(fat.freemapgroups)
+	inc	hl				; the first group may be visited twice
+	ld	(.groups),hl
+.group:
+	ld	bc,(.sector)
+	ld	a,(fat.freemapshift)
+	ld	l,a
+	xor	a,a
+	call	__lshru
+	ld	(.groupindex),bc
+	ld	a,(fat.freemapshift)
+	ld	l,a
+	xor	a,a
+	call	__lshl				; bc = first sector of group
+	ld	hl,(fat.freemapgroup)
+	add	hl,bc
+	ex	de,hl
+	ld	hl,(_fat_state + 8)
+	or	a,a
+	sbc	hl,de
+	jr	nc,.inrange
+	add	hl,de
+	ex	de,hl
+.inrange:
+	ld	(.end),de			; end = min(first + group, fat_size)
+	ld	hl,(.sector)
+	or	a,a
+	sbc	hl,bc
+	ld	a,0
+	jr	nz,.partial
+	ld	a,(.entry)
+	sub	a,1
+	sbc	a,a
+.partial:
+	ld	(.clean),a			; whole group will be scanned
+	ld	bc,(.groupindex)
+	call	fat.freemapbit
+	and	a,(hl)
+	jr	nz,.nextgroup			; group is known to be full
+.scansector:
+	call	.readfat
+	ld	a,(.entry)
+	call	.entryptr
+	ld	a,(.entry)
+	ld	c,a
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	nz,.scan32
+.scan16:
+	ld	a,(hl)
+	inc	hl
+	or	a,(hl)
+	inc	hl
+	jr	z,.found
+	inc	c
+	jr	nz,.scan16
+	jr	.sectorfull
+.scan32:
+	ld	a,(hl)
+	inc	hl
+	or	a,(hl)
+	inc	hl
+	or	a,(hl)
+	inc	hl
+	ld	b,a
+	ld	a,(hl)
+	inc	hl
+	and	a,$0f
+	or	a,b
+	jr	z,.found
+	inc	c
+	bit	7,c
+	jr	z,.scan32
+.sectorfull:
+	xor	a,a
+	ld	(.entry),a
+	ld	hl,(.sector)
+	inc	hl
+	ld	(.sector),hl
+	ld	de,(.end)
+	or	a,a
+	sbc	hl,de
+	jr	c,.scansector
+	ld	a,(.clean)
+	or	a,a
+	jr	z,.nextgroup
+	ld	bc,(.groupindex)
+	call	fat.freemapbit
+	or	a,(hl)
+	ld	(hl),a				; remember the group is full
+.nextgroup:
+	xor	a,a
+	ld	(.entry),a
+	ld	hl,(.end)
+	ld	de,(_fat_state + 8)
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	jr	c,.advance
+	or	a,a
+	sbc	hl,hl				; wrap around to the first fat sector
+.advance:
+	ld	(.sector),hl
+	ld	hl,(.groups)
+	dec	hl
+	ld	(.groups),hl
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jq	nz,.group
+	ld	e,l				; return 0
+	ld	sp,ix
+	pop	ix
+	ret
+.found:
+	ld	a,c
+	ld	(.entry),a
+	ld	bc,(.sector)
+	ld	a,(_fat_state + 24)
+	ld	l,a
+	ld	a,8
+	sub	a,l
+	ld	l,a
+	xor	a,a
+	call	__lshl
+	ld	e,a
+	push	bc
+	pop	hl
+	ld	a,(.entry)
+	or	a,l
+	ld	l,a				; cluster = sector * entries per sector + entry
+	ld	bc,(.limit)
+	ld	a,(.limit + 3)
+	call	__lcmpu
+	jq	nc,.nextgroup			; past the last cluster
+	ld	(.cluster),hl
+	ld	a,e
+	ld	(.cluster + 3),a
+	ld	a,(.entry)
+	call	.entryptr
+	ld	(hl),$ff
+	inc	hl
+	ld	(hl),$ff
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	z,.eoc16
+	inc	hl
+	ld	(hl),$ff
+	inc	hl
+	ld	a,(hl)
+	or	a,$0f
+	ld	(hl),a				; end of chain mark, keep reserved bits
+.eoc16:
+	call	.writefat
+	ld	hl,(ix + 15)
+	ld	e,(ix + 18)
+	call	__lcmpzero
+	jr	z,.firstcluster
+	call	.locate
+	call	.readfat
+	ld	a,(.entry)
+	call	.entryptr
+	ld	bc,(.cluster)
+	ld	(hl),c
+	inc	hl
+	ld	(hl),b
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	z,.link16
+	inc	hl
+	ld	a,(.cluster + 2)
+	ld	(hl),a
+	inc	hl
+	ld	a,(hl)
+	and	a,$f0
+	ld	b,a
+	ld	a,(.cluster + 3)
+	or	a,b
+	ld	(hl),a
+.link16:
+	call	.writefat			; old_cluster -> cluster
+	jr	.hints
+.firstcluster:
+	ld	hl,(ix + 6)
+	ld	e,(ix + 9)
+	call	fat.sectorptr
+	push	hl
+	ld	d,(ix + 12)
+	ld	e,32
+	mlt	de
+	add	hl,de
+	ld	de,20
+	add	hl,de
+	ld	de,(.cluster + 2)
+	ld	(hl),e
+	inc	hl
+	ld	(hl),d				; sect[index * 32 + 20] = cluster >> 16
+	ld	de,5
+	add	hl,de
+	ld	de,(.cluster)
+	ld	(hl),e
+	inc	hl
+	ld	(hl),d				; sect[index * 32 + 26] = cluster
+	pop	bc
+	ld	hl,(ix + 6)
+	ld	e,(ix + 9)
+	call	fat.writesectorbc
+.hints:
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	e,a
+	ld	bc,1
+	xor	a,a
+	call	__ladd
+	ld	(fat.nextfree),hl
+	ld	a,e
+	ld	(fat.nextfree + 3),a		; next free = cluster + 1
+	ld	hl,(fat.freecount)
+	ld	a,(fat.freecount + 3)
+	ld	e,a
+	ld	bc,1
+	xor	a,a
+	call	__ladd
+	call	__lcmpzero
+	jr	z,.done				; free count unknown
+	ld	bc,2
+	xor	a,a
+	call	__lsub
+	ld	(fat.freecount),hl
+	ld	a,e
+	ld	(fat.freecount + 3),a		; free count--
+.done:
+	ld	hl,(.cluster)
+	ld	a,(.cluster + 3)
+	ld	e,a
+	ld	sp,ix
+	pop	ix
+	ret
+
+; euhl = cluster
+; sets the fat sector index and entry in sector of the cluster
+.locate:
+	ld	a,(_fat_state + 24)
+	rrca
+	cpl
+	and	a,l
+	ld	(.entry),a
+	push	hl
+	pop	bc
+	ld	a,(_fat_state + 24)
+	ld	l,a
+	ld	a,8
+	sub	a,l
+	ld	l,a
+	ld	a,e
+	call	__lshru
+	ld	(.sector),bc
+	ret
+
+; returns hl -> data of current fat sector
+.readfat:
+	ld	hl,(.sector)
+	ld	bc,(_fat_state + 12)
+	add	hl,bc
+	ld	a,(_fat_state + 15)
+	adc	a,0
+	ld	e,a
+	call	fat.sectorptr
+	ld	(.ptr),hl
+	ret
+
+; writes the current fat sector to both fats
+.writefat:
+	ld	hl,(.sector)
+	ld	bc,(_fat_state + 12)
+	add	hl,bc
+	ld	a,(_fat_state + 15)
+	adc	a,0
+	ld	e,a
+	push	de
+	push	hl
+	ld	bc,(.ptr)
+	call	fat.writesectorbc
+	pop	hl
+	pop	de
+	ld	bc,(_fat_state + 8)
+	xor	a,a
+	call	__ladd
+	ld	bc,(.ptr)
+	jp	fat.writesectorbc
+
+; a = entry in sector
+; returns hl -> entry in current fat sector
+.entryptr:
+	or	a,a
+	sbc	hl,hl
+	ld	l,a
+	add	hl,hl
+	ld	a,(_fat_state + 24)
+	or	a,a
+	jr	z,.entry16
+	add	hl,hl
+.entry16:
+	ld	de,(.ptr)
+	add	hl,de
+	ret
+
+.limit:
+	dd	0
+.cluster:
+	dd	0
+.sector:
+	dl	0
+.end:
+	dl	0
+.groupindex:
+	dl	0
+.groups:
+	dl	0
+.ptr:
+	dl	0
+.entry:
+	db	0
+.clean:
+	db	0
+
 ;-------------------------------------------------------------------------------
 fat.endofchainmark:
 	pop	de
@@ -788,10 +3363,46 @@ fat.readsectora:
 ;-------------------------------------------------------------------------------
 ; euhl = sector lba
 fat.readsector:
+	ld	bc,(fat.sectorbuffer)
+;	jr	fat.readsectorbc
+
+;-------------------------------------------------------------------------------
+; euhl = sector lba
+; bc -> buffer
+fat.readsectorbc:
+	ld	a,(cache.entries)
+	or	a,a
+	jr	nz,.cached
+	push	bc
 	ld	bc,scsiRead10Lba
 	call	fat.addpartitionlba
-	ld	de,(fat.sectorbuffer)
+	pop	de
 	jp	scsiRequestRead
+.cached:
+	push	iy
+	push	bc
+	call	cache.load
+	pop	de
+	ld	bc,512
+	ldir
+	pop	iy
+	ret
+
+;-------------------------------------------------------------------------------
+; euhl = sector lba
+; returns hl -> sector data, which is only valid until the next sector access
+fat.sectorptr:
+	ld	a,(cache.entries)
+	or	a,a
+	jr	z,.uncached
+	push	iy
+	call	cache.load
+	pop	iy
+	ret
+.uncached:
+	call	fat.readsector
+	ld	hl,(fat.sectorbuffer)
+	ret
 
 ;-------------------------------------------------------------------------------
 ; auhl = sector lba
@@ -802,29 +3413,35 @@ fat.writesectora:
 ;-------------------------------------------------------------------------------
 ; euhl = sector lba
 fat.writesector:
+	ld	bc,(fat.sectorbuffer)
+;	jr	fat.writesectorbc
+
+;-------------------------------------------------------------------------------
+; euhl = sector lba
+; bc -> buffer
+fat.writesectorbc:
+	ld	a,(cache.entries)
+	or	a,a
+	jr	nz,.cached
+	push	bc
 	ld	bc,scsiWrite10Lba
 	call	fat.addpartitionlba
-	ld	de,(fat.sectorbuffer)
+	pop	de
 	jp	scsiRequestWrite
+.cached:
+	push	iy
+	call	cache.store
+	pop	iy
+	ret
 
 ;-------------------------------------------------------------------------------
 _fat_ReadSector:
 	ld	iy,0
 	add	iy,sp
-	ld	de,(iy + 3)
-	push	de
+	ld	bc,(iy + 3)
 	ld	hl,(iy + 6)
 	ld	e,(iy + 9)
-	ld	bc,scsiRead10Lba
-	call	fat.addpartitionlba
-;	call	debugStr
-;	db	'rd ',0
-;	ld	hl,scsiRead10Lba
-;	call	debugHexBlockHL
-;	db	4
-;	call    debugNewLine
-	pop	de
-	call	scsiRequestRead
+	call	fat.readsectorbc
 	xor	a,a
 	ret
 
@@ -832,20 +3449,10 @@ _fat_ReadSector:
 _fat_WriteSector:
 	ld	iy,0
 	add	iy,sp
-	ld	de,(iy + 3)
-	push	de
+	ld	bc,(iy + 3)
 	ld	hl,(iy + 6)
 	ld	e,(iy + 9)
-	ld	bc,scsiWrite10Lba
-	call	fat.addpartitionlba
-;	call	debugStr
-;	db	'wr ',0
-;	ld	hl,scsiWrite10Lba
-;	call	debugHexBlockHL
-;	db	4
-;	call    debugNewLine
-	pop	de
-	call	scsiRequestWrite
+	call	fat.writesectorbc
 	xor	a,a
 	ret
 
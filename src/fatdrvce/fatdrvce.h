@@ -67,6 +67,7 @@
 #define H_FATDRVCE
 
 #include <setjmp.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -89,6 +90,16 @@ typedef struct {
     uint8_t padding[2]; /**< Extra padding (reserved) */
 } fat_entry_t;
 
+/**
+ * Directory handle, set up by \c fat_OpenDir and advanced by \c fat_ReadDir,
+ * \c fat_ReadDirLong and \c fat_FindEntry. It holds the first and current
+ * cluster of the directory, the current sector and the next entry, so it does
+ * not need to be closed, and can be copied to remember a position.
+ */
+typedef struct {
+    uint8_t data[16];   /**< Internal iteration state. */
+} fat_dir_t;
+
 #define	FAT_O_WRONLY      2               /**< Open Write only mode. */
 #define	FAT_O_RDONLY      1               /**< Open Read only mode */
 #define	FAT_O_RDWR (O_RDONLY | O_WRONLY)  /**< Open in Read and Write mode. */
@@ -107,6 +118,16 @@ typedef enum msd_event {
     MSD_EVENT_XFER_ERROR  /**< The MSD device encountered a transfer error. */
 } msd_event_t;
 
+#define MSD_ASYNC_MAX 3 /**< Number of requests that can be queued at once. */
+
+/**
+ * Called once an asynchronous request has completed.
+ * @param buffer Buffer given with the request.
+ * @param sector First sector of the request.
+ * @param data User data given with the request.
+ */
+typedef void (*msd_callback_t)(uint8_t *buffer, uint32_t sector, void *data);
+
 /**
  * Initializes the FAT filesystem and allows other FAT functions to be used.
  * Before calling this function, you must use \c fat_Find and \c fat_Select
@@ -123,7 +144,8 @@ uint8_t fat_Init(void);
  * This function should be called with each corresponding \c fat_Init
  * function call. It should not be called in a device error handler,
  * only in the case of a graceful exit, otherwise an infinite loop may
- * occur.
+ * occur. On FAT32 partitions, the free cluster count and next free cluster
+ * hint in the FSInfo sector are updated.
  * @return None.
  */
 void fat_Deinit(void);
@@ -153,10 +175,10 @@ uint8_t fat_Find(fat_partition_t *result, uint8_t max);
 void fat_Select(fat_partition_t *list, uint8_t index);
 
 /**
- * Opens a file on the device, given an absolute path. Names must use the 8.3
- * path format. No support for long file names is given. The file must exist,
- * or be created with \c fat_Create.
- * @param path Absolute 8.3 file path name.
+ * Opens a file on the device, given an absolute path. Each path component can
+ * be an 8.3 name or a long file name, and is matched without regard to case.
+ * The file must exist, or be created with \c fat_Create.
+ * @param path Absolute file path name.
  * @param flags \c FAT_O_WRONLY, \c FAT_O_RDONLY, \c FAT_O_RDWR for write only,
  * read only, and read/write respectively.
  * @return A FAT file descriptor, or a value less than 0 on error.
@@ -164,7 +186,8 @@ void fat_Select(fat_partition_t *list, uint8_t index);
 int8_t fat_Open(const char *path, int flags);
 
 /**
- * Closes and frees any open file descriptor.
+ * Closes and frees any open file descriptor. Any modified sectors held in the
+ * cache are written back to the device.
  * @param fd File descriptor.
  * @return None.
  */
@@ -179,7 +202,8 @@ uint32_t fat_GetFileSize(int8_t fd);
 
 /**
  * Sets the file size.
- * @param path Absolute 8.3 formatted file path.
+ * @param path Absolute file path. Each path component can be an 8.3 name or a
+ * long file name, matched without regard to case.
  * @param size New file size.
  * @return None.
  */
@@ -201,11 +225,32 @@ uint32_t fat_Tell(int8_t fd);
 void fat_SetBuffer(void *buffer);
 
 /**
- * Seeks to an arbitrary sector in the flash file. If the sector is beyond
- * the size of the file, the file allocation is extended. \p pos must be a
- * multiple of 512, or 0. Arbitrary seek positions are not supported.
+ * Sets up a write-back cache used for filesystem sectors. Recently used FAT
+ * table and directory sectors are kept in the cache, so walking cluster chains
+ * or looking up paths does not need to access the device every time. Modified
+ * sectors are written back when evicted, or when \c fat_Flush, \c fat_Close,
+ * \c fat_Select or \c fat_Deinit is called.
+ * @param cache Pointer to cache memory, must be at least \p sectors * 512 bytes.
+ * @param sectors Number of sectors to cache, up to 8. Pass 0 to disable caching.
+ * @return None.
+ */
+void fat_SetCache(void *cache, uint8_t sectors);
+
+/**
+ * Writes any modified sectors held in the cache back to the device.
+ * @return None.
+ */
+void fat_Flush(void);
+
+/**
+ * Seeks to an arbitrary position in the flash file. If the position is beyond
+ * the size of the file, the file allocation is extended. When using the
+ * sector functions, \p pos must be a multiple of 512, or 0. Any position can
+ * be used with \c fat_Read and \c fat_Write. The clusters of each open file
+ * are remembered as they are visited, so seeking back to an earlier position
+ * does not need to follow the cluster chain from the start of the file.
  * @param fd File descriptor
- * @param pos 512 byte multiple offset in file descriptor.
+ * @param pos Offset in file descriptor.
  * @return false if an error occurs.
  */
 bool fat_Seek(int8_t fd, uint32_t pos);
@@ -229,17 +274,70 @@ bool fat_ReadSector(int8_t fd);
  */
 bool fat_WriteSector(int8_t fd);
 
+/**
+ * Reads multiple 512 byte sectors of a file into \p buffer, starting at the
+ * current file position. Runs of contiguous clusters are transferred using a
+ * single command, which is much faster than repeated \c fat_ReadSector calls.
+ * If the end of the file is reached in the middle of a sector, garbage may be
+ * read into the excess buffer locations.
+ * @param fd File descriptor
+ * @param buffer Buffer to read into, must be at least \p count * 512 bytes.
+ * @param count Number of sectors to read.
+ * @return Number of sectors read.
+ */
+uint8_t fat_ReadSectors(int8_t fd, void *buffer, uint8_t count);
+
+/**
+ * Writes multiple 512 byte sectors from \p buffer into the current file
+ * position. Runs of contiguous clusters are transferred using a single command.
+ * The file is extended as needed, and the file size is updated if the file
+ * position moves past the end of the file.
+ * @param fd File descriptor
+ * @param buffer Buffer to write from, must be at least \p count * 512 bytes.
+ * @param count Number of sectors to write.
+ * @return Number of sectors written.
+ */
+uint8_t fat_WriteSectors(int8_t fd, const void *buffer, uint8_t count);
+
+/**
+ * Reads bytes from the current file position, which does not need to be
+ * sector aligned. Whole sectors are transferred directly into \p buffer using
+ * multi-sector transfers, while partial sectors are read through the sector
+ * cache. Setting up a cache with \c fat_SetCache is recommended when doing
+ * many small reads.
+ * @param fd File descriptor
+ * @param buffer Buffer to read into.
+ * @param size Number of bytes to read.
+ * @return Number of bytes read, which is less than \p size at the end of the file.
+ */
+size_t fat_Read(int8_t fd, void *buffer, size_t size);
+
+/**
+ * Writes bytes to the current file position, which does not need to be
+ * sector aligned. Whole sectors are transferred directly from \p buffer using
+ * multi-sector transfers, while partial sectors are modified in the sector
+ * cache and written back later. The file is extended as needed, and the file
+ * size is updated if the file position moves past the end of the file.
+ * @param fd File descriptor
+ * @param buffer Buffer to write from.
+ * @param size Number of bytes to write.
+ * @return Number of bytes written.
+ */
+size_t fat_Write(int8_t fd, const void *buffer, size_t size);
+
 /**
  * Deletes a file given an absolute path.
- * @param path Absolute 8.3 file path name.
+ * @param path Absolute file path. Each path component can be an 8.3 name or a
+ * long file name, matched without regard to case.
  * @return false if an error occurs.
  */
 bool fat_Delete(const char *path);
 
 /**
  * Creates a new file or directory on the device given an absolute path and name.
- * @param path Absolute 8.3 formatted directory path.
- * @param name 8.3 formatted file name.
+ * @param path Absolute directory path. Each path component can be an 8.3 name
+ * or a long file name, matched without regard to case.
+ * @param name 8.3 formatted file name. Long file name entries are not created.
  * @param attrib FAT style attributes. Can be an combination of \c FAT_RDONLY,
  * \c FAT_HIDDEN, \c FAT_SYSTEM, \c FAT_SUBDIR.
  * @return false if an error occurs.
@@ -248,6 +346,8 @@ bool fat_Create(char *path, char *name, uint8_t attrib);
 
 /**
  * Gets the attributes for a file on the device.
+ * @param path Absolute file path. Each path component can be an 8.3 name or a
+ * long file name, matched without regard to case.
  * @return Returns 255 if no valid stats, otherwise a bitmask of valid FAT
  * attributes.
  */
@@ -255,7 +355,8 @@ uint8_t fat_GetAttrib(const char *path);
 
 /**
  * Sets the attributes for a file on the device
- * @param path Absolute 8.3 formatted file path.
+ * @param path Absolute file path. Each path component can be an 8.3 name or a
+ * long file name, matched without regard to case.
  * @param attrib FAT style attributes. Can be an combination of \c FAT_RDONLY,
  * \c FAT_HIDDEN, \c FAT_SYSTEM, \c FAT_SUBDIR.
  * @return None.
@@ -264,16 +365,70 @@ void fat_SetAttrib(const char *path, uint8_t stat);
 
 /**
  * Returns all FAT file / directory entires in a path.
- * @param path Absolute 8.3 formatted root path. Can be NULL for root directory.
+ * @param path Absolute directory path. Can be NULL for root directory. Each
+ * path component can be an 8.3 name or a long file name, matched without regard
+ * to case.
  * @param list Storage location for directory entries. Must be pre-allocated.
  * @param directories Only return directories if not 0.
  * @param size Number of allocated \c fat_entry_t available.
  * @param skip Number of entries to skip adding to the list. Useful for memory
  * constraints.
  * @return Number of entries found.
+ * @note Each call searches the directory from the start. Use \c fat_OpenDir
+ * and \c fat_ReadDir to page through large directories.
  */
 int fat_DirList(const char *path, fat_entry_t *list, uint8_t directories, int size, int skip);
 
+/**
+ * Opens a directory for reading its entries one at a time. Recently resolved
+ * directories are remembered, so opening paths that share a parent does not
+ * search from the root directory each time.
+ * @param path Absolute directory path. Can be NULL or "/" for the root
+ * directory. Each path component can be an 8.3 name or a long file name,
+ * matched without regard to case.
+ * @param dir Directory handle to initialize.
+ * @return false if the path does not exist or is not a directory.
+ */
+bool fat_OpenDir(const char *path, fat_dir_t *dir);
+
+/**
+ * Moves a directory handle back to the first entry of the directory.
+ * @param dir Directory handle.
+ * @return None.
+ */
+void fat_RewindDir(fat_dir_t *dir);
+
+/**
+ * Reads the next entry of a directory. Deleted entries and long filename
+ * entries are skipped.
+ * @param dir Directory handle.
+ * @param entry Storage for the directory entry.
+ * @return false once there are no more entries.
+ */
+bool fat_ReadDir(fat_dir_t *dir, fat_entry_t *entry);
+
+/**
+ * Reads the next entry of a directory along with its long file name.
+ * Deleted entries are skipped.
+ * @param dir Directory handle.
+ * @param entry Storage for the directory entry.
+ * @param name Storage for the name of the entry, at least 256 bytes. Receives
+ * the long file name, or the 8.3 name if the entry does not have one.
+ * Characters outside of ASCII are replaced with '?'.
+ * @return false once there are no more entries.
+ */
+bool fat_ReadDirLong(fat_dir_t *dir, fat_entry_t *entry, char *name);
+
+/**
+ * Looks up an entry by name in a directory. On success, reading continues
+ * after the found entry.
+ * @param dir Directory handle.
+ * @param name Long or 8.3 name of the entry, matched without regard to case.
+ * @param entry Storage for the directory entry.
+ * @return false if the directory does not contain the name.
+ */
+bool fat_FindEntry(fat_dir_t *dir, const char *name, fat_entry_t *entry);
+
 /**
  * Selects the first found attached Mass Storage Device (MSD).
  * This is an alternative to using \c msd_Find and \c msd_Select.
@@ -312,7 +467,8 @@ void msd_Select(msd_t *list, uint8_t index);
 void msd_KeepAlive(void);
 
 /**
- * Directly reads a 512 byte sector from the Mass Storage Device
+ * Directly reads a 512 byte sector from the Mass Storage Device.
+ * This bypasses the sector cache set with \c fat_SetCache.
  * @param buffer Pointer to allocated 512 byte buffer to read into.
  * @param sector Logical Block Address (LBA) of sector to read.
  * @return None.
@@ -327,6 +483,71 @@ void msd_ReadSector(uint8_t *buffer, uint32_t sector);
  */
 void msd_WriteSector(uint8_t *buffer, uint32_t sector);
 
+/**
+ * Directly reads multiple 512 byte sectors from the Mass Storage Device using
+ * a single SCSI command.
+ * @param buffer Pointer to allocated buffer of at least \p count * 512 bytes.
+ * @param sector Logical Block Address (LBA) of first sector to read.
+ * @param count Number of sectors to read.
+ * @return None.
+ */
+void msd_ReadSectors(uint8_t *buffer, uint32_t sector, uint8_t count);
+
+/**
+ * Directly writes multiple 512 byte sectors to the Mass Storage Device using
+ * a single SCSI command.
+ * @param buffer Pointer to buffer of at least \p count * 512 bytes to write.
+ * @param sector Logical Block Address (LBA) of first sector to write.
+ * @param count Number of sectors to write.
+ * @return None.
+ */
+void msd_WriteSectors(uint8_t *buffer, uint32_t sector, uint8_t count);
+
+/**
+ * Queues a read of multiple 512 byte sectors from the Mass Storage Device and
+ * returns without waiting for it. Requests are sent one at a time in the order
+ * they were queued, so with two or three buffers the next sectors can be
+ * transferring while the previous ones are being processed.
+ * @param buffer Pointer to allocated buffer of at least \p count * 512 bytes.
+ * The buffer must not be used until the request completes.
+ * @param sector Logical Block Address (LBA) of first sector to read.
+ * @param count Number of sectors to read.
+ * @param callback Called from \c msd_Poll once the sectors are in the buffer.
+ * Can be NULL.
+ * @param data User data passed to \p callback.
+ * @return false if \c MSD_ASYNC_MAX requests are already queued.
+ */
+bool msd_ReadSectorsAsync(uint8_t *buffer, uint32_t sector, uint8_t count, msd_callback_t callback, void *data);
+
+/**
+ * Queues a write of multiple 512 byte sectors to the Mass Storage Device and
+ * returns without waiting for it.
+ * @param buffer Pointer to buffer of at least \p count * 512 bytes to write.
+ * The buffer must not be modified until the request completes.
+ * @param sector Logical Block Address (LBA) of first sector to write.
+ * @param count Number of sectors to write.
+ * @param callback Called from \c msd_Poll once the sectors are written.
+ * Can be NULL.
+ * @param data User data passed to \p callback.
+ * @return false if \c MSD_ASYNC_MAX requests are already queued.
+ */
+bool msd_WriteSectorsAsync(uint8_t *buffer, uint32_t sector, uint8_t count, msd_callback_t callback, void *data);
+
+/**
+ * Advances queued asynchronous requests without blocking. Completed requests
+ * have their callbacks run, after the next request has been sent.
+ * This should be called often while requests are queued.
+ * @return Number of requests still queued.
+ * @note Any other MSD or FAT function waits for queued requests first.
+ */
+uint8_t msd_Poll(void);
+
+/**
+ * Waits until all queued asynchronous requests have completed.
+ * @return None.
+ */
+void msd_Wait(void);
+
 /**
  * Uses a buffer instantiated with \c setjmp as a handle
  * in the event of an error or a detachment of the usb device.
@@ -100,6 +100,7 @@ ti_AllocEqu:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_AllocCplxList:
 ; allocates space for a complex list
 ; args:
@@ -165,6 +166,7 @@ util_alloc_var:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_CloseAll:
 ; closes all currently open file handles
 ; args:
@@ -180,6 +182,7 @@ ti_CloseAll:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Resize:
 ; resizes an appvar variable
 ; args:
@@ -236,6 +239,7 @@ ti_Resize:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_IsArchived:
 ; Checks if a variable is archived
 ; args:
@@ -265,6 +269,7 @@ util_is_in_ram:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_OpenVar:
 ; opens a variable
 ; args:
@@ -415,6 +420,7 @@ ti_Open:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_SetArchiveStatus:
 ; sets the archive status of a slot index
 ; args:
@@ -484,6 +490,7 @@ ti_SetArchiveStatus:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Write:
 ; writes a chunk of data into a slot handle
 ; args:
@@ -653,6 +660,7 @@ ti_GetC:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_PutC:
 ; Performs an fputc on an AppVar
 ; args:
@@ -715,6 +723,7 @@ char_in := $-1
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Seek:
 ; seeks to a particular offset in an slot index
 ; args:
@@ -759,6 +768,7 @@ ti_Seek:
 	jr	.seek_set_asm
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_DeleteVar:
 ; deletes an arbitrary variable
 ; args:
@@ -804,6 +814,7 @@ ti_Delete:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Rewind:
 ; Performs an frewind on a variable
 ; args:
@@ -824,6 +835,7 @@ ti_Rewind:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Tell:
 ; gets the current offset of an open slot index
 ; args:
@@ -842,6 +854,7 @@ ti_Tell:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_GetSize:
 ; gets the size of an open slot index
 ; args:
@@ -860,6 +873,7 @@ ti_GetSize:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_Close:
 ; closes an open slot index
 ; args:
@@ -879,6 +893,7 @@ ti_Close:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_DetectAny:
 ; finds any variable that starts with some data
 ; args:
@@ -1042,6 +1057,7 @@ ti_Detect:
 	dl	0
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_GetTokenString:
 ; return pointer to next token string
 ; args:
@@ -1090,6 +1106,7 @@ ti_GetTokenString:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_GetDataPtr:
 ; return a pointer to the current location in the given variable
 ; args:
@@ -1111,6 +1128,7 @@ ti_GetDataPtr:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_GetVATPtr:
 ; return a pointer to the vat location in the given variable
 ; args:
@@ -1128,6 +1146,7 @@ ti_GetVATPtr:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_GetName:
 ; gets the variable name of an open slot index
 ; args:
@@ -1162,6 +1181,7 @@ ti_GetName:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_RenameVar:
 ; renames a variable with a new name
 ; args:
@@ -1274,6 +1294,7 @@ ti_Rename:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_SetVar:
 ; sets an os variable structure value
 ; args:
@@ -1308,6 +1329,7 @@ ti_SetVar:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_StoVar:
 ; stores an os variable to a variable data structure
 ; args:
@@ -1346,6 +1368,7 @@ ti_StoVar:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_RclVar:
 ; gets a pointer to a variable data structure
 ; args:
@@ -1376,6 +1399,7 @@ ti_RclVar:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 ti_ArchiveHasRoom:
 ; checks if there is room in the archive before a garbage collect
 ; args:
@@ -1398,6 +1422,7 @@ ti_ArchiveHasRoom:
 ;-------------------------------------------------------------------------------
 
 ;-------------------------------------------------------------------------------
+	extract_section
 util_skip_archive_header:
 ; in:
 ;  hl -> start of archived vat entry
@@ -1413,6 +1438,7 @@ util_skip_archive_header:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 util_set_var_str:
 ; in:
 ;  hl -> string
@@ -1426,6 +1452,7 @@ util_set_var_str:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 util_insert_mem:
 	call	util_get_data_ptr
 	push	hl
@@ -1576,6 +1603,7 @@ util_set_offset:
 ;-------------------------------------------------------------------------------
 ; Internal library data
 ;-------------------------------------------------------------------------------
+	extract_section
 
 variable_offsets:
 	dl	0, 0, 0, 0, 0
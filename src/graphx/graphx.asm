@@ -2,7 +2,7 @@
 include '../include/library.inc'
 ;-------------------------------------------------------------------------------
 
-library 'GRAPHX', 11
+library 'GRAPHX', 12
 
 ;-------------------------------------------------------------------------------
 ; no dependencies
@@ -133,11 +133,24 @@ library 'GRAPHX', 11
 ; v10 functions
 ;-------------------------------------------------------------------------------
 	export gfx_CopyRectangle
+;-------------------------------------------------------------------------------
+; v12 functions
+;-------------------------------------------------------------------------------
+	export gfx_SetCursorImage
+	export gfx_SetCursorColors
+	export gfx_SetCursorPosition
+	export gfx_ShowCursor
+	export gfx_HideCursor
+	export gfx_Polyline
+	export gfx_Lines
+	export gfx_Pixels
 
 ;-------------------------------------------------------------------------------
 LcdSize            := LcdWidth*LcdHeight
 ; minimum stack size to provide for interrupts if moving the stack
 InterruptStackSize := 4000
+; bytes at the start of the cursor image ram used by the fast fills
+CursorRamBorrowed  := 128
 CurrentBuffer      := mpLcdLpbase
 TRASPARENT_COLOR   := 0
 TEXT_FG_COLOR      := 0
@@ -180,23 +193,30 @@ postpone
 end postpone
 
 ;-------------------------------------------------------------------------------
+; the sites are stored as absolute addresses rather than offsets, so they are
+; relocated and libload extracts every section holding one of them
 macro setSmcBytes name*
-	local addr, data
+	local temp, list
 	postpone
-		virtual at addr
-			irpv each, name
-				if % = 1
-					db %%
-				end if
-				assert each >= addr + 1 + 2*%%
-				dw each - $ - 2
-			end irpv
-			load data: $-$$ from $$
-		end virtual
+		irpv each, name
+			if % = 1
+				temp equ each
+			else
+				temp equ temp, each
+			end if
+		end irpv
+		list equ temp
 	end postpone
 
 	call	_SetSmcBytes
-addr	db	data
+	match expand, list
+		iterate expand
+			if % = 1
+				db	%%
+			end if
+			dl	each
+		end iterate
+	end match
 end macro
 
 macro setSmcBytesFast name*
@@ -305,11 +325,17 @@ gfx_End:
 ; Returns:
 ;  None
 	call	_boot_ClearVRAM		; clear the screen
+	ld	hl,mpLcdCrsrCtrl
+	res	0,(hl)			; hide the hardware cursor
+	ld	a,$C9			; ret
+	ld	(_BorrowCursorRam),a	; fast fills no longer save the cursor ram
+	ld	(_ReturnCursorRam),a
 	ld	de,lcdNormalMode
 	ld	hl,mpLcdBase
 	jr	SetGfx			; restore the screen mode
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_AllocSprite:
 ; Allocates space for a new sprite
 ; Arguments:
@@ -342,6 +368,7 @@ gfx_AllocSprite:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetClipRegion:
 ; Sets the clipping region for clipped routines
 ; Arguments:
@@ -365,6 +392,7 @@ gfx_SetClipRegion:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Lighten:
 ; Lightens a 16 bit 1555 color (0 = white, 255 = same color)
 ; Arguments:
@@ -395,6 +423,7 @@ gfx_Lighten:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Darken:
 ; Darkens a 16 bit 1555 color (0 = black, 255 = same color)
 ; Arguments:
@@ -459,6 +488,7 @@ _Darken:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetColor:
 ; Sets the global color index for all routines
 ; Arguments:
@@ -468,6 +498,7 @@ gfx_SetColor:
 	setSmcBytesFast _Color
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTransparentColor:
 ; Sets the global transparent color index for all routines
 ; Arguments:
@@ -477,6 +508,7 @@ gfx_SetTransparentColor:
 	setSmcBytes _TransparentColor
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FillScreen:
 ; Fills the screen with the specified color index
 ; Arguments:
@@ -489,6 +521,10 @@ FillScreen_NumIters      := (LcdSize-InterruptStackSize)/(FillScreen_PushesPerIt
 FillScreen_BytesToPush   := FillScreen_PushesPerIter*3*FillScreen_NumIters
 FillScreen_BytesToLddr   := LcdSize-FillScreen_BytesToPush
 
+	ld	hl,3
+	add	hl,sp
+	ld	a,(hl)			; a = color
+	call	_BorrowCursorRam
 	ld	iy,0
 	add	iy,sp			; iy = original sp
 	ld	hl,FillScreen_FastCode_SrcEnd-1
@@ -502,14 +538,18 @@ FillScreen_BytesToLddr   := LcdSize-FillScreen_BytesToPush
 	inc	hl			; hl  = pointer to last push (already copied)
 	ld	c,FillScreen_PushesPerIter-1
 	lddr				; fill push run
-	ld	a,$E1
-	ld	(de),a			; write initial pop hl
+	ex	de,hl
+	ld	(hl),$E1		; write initial pop hl
 	ld	hl,(CurrentBuffer)
 	ld	de,LcdSize
 	add	hl,de			; hl = end (exclusive) of buffer
-	ld	de,(iy+1)		; deu = color
-	ld	d,(iy+3)		; d = color
-	ld	e,d			; e = color
+	ld	d,a
+	ld	e,a
+	push	de
+	dec	sp
+	pop	de			; deu = color
+	inc	sp
+	ld	e,a			; de = color in every byte
 	ld	b,FillScreen_NumIters	; b = number of fast code iterations
 	call	gfx_Wait
 	ld	sp,hl			; sp = end (exclusive) of buffer
@@ -522,7 +562,7 @@ FillScreen_BytesToLddr   := LcdSize-FillScreen_BytesToPush
 	dec	de			; de = pointer to first byte to slow-fill
 	ld	bc,FillScreen_BytesToLddr
 	lddr				; finish with slow fill
-	ret
+	jp	_ReturnCursorRam
 
 _FillScreen_FastCode_Src:
 	org mpLcdCrsrImage
@@ -539,8 +579,53 @@ FillScreen_FastCode_DestSize := FillScreen_FastCode_DestEnd-_FillScreen_FastCode
 FillScreen_FastCode_SrcSize  := FillScreen_FastCode_DestSize-(FillScreen_PushesPerIter-1+1)
 	org _FillScreen_FastCode_Src+FillScreen_FastCode_SrcSize
 FillScreen_FastCode_SrcEnd   := $
+assert FillScreen_FastCode_DestSize <= CursorRamBorrowed
+
+;-------------------------------------------------------------------------------
+	extract_section
+_BorrowCursorRam:
+; Saves the start of the cursor image ram below the stack, if a cursor image
+; is there, for a fast fill to use
+; Inputs:
+;  None
+; Outputs:
+;  sp lowered by CursorRamBorrowed bytes, or unchanged
+;  a, bc, de preserved
+	ret				; nop once a cursor image is there
+	pop	iy			; iy = return vector
+	ld	hl,-CursorRamBorrowed
+	add	hl,sp
+	ld	sp,hl
+	push	de
+	push	bc
+	ex	de,hl			; de = room below the stack
+	ld	hl,mpLcdCrsrImage
+	ld	bc,CursorRamBorrowed
+	ldir
+	pop	bc
+	pop	de
+	jp	(iy)
+
+;-------------------------------------------------------------------------------
+	extract_section
+_ReturnCursorRam:
+; Restores the cursor image ram saved by _BorrowCursorRam, and returns from the
+; fast fill. Must be jumped to, not called.
+; Inputs:
+;  sp as left by _BorrowCursorRam
+; Outputs:
+;  None
+	ret				; nop once a cursor image is there
+	ld	hl,0
+	add	hl,sp
+	ld	de,mpLcdCrsrImage
+	ld	bc,CursorRamBorrowed
+	ldir
+	ld	sp,hl			; sp = original sp
+	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ZeroScreen:
 ; Fills the screen with color index 0
 ; Arguments:
@@ -554,6 +639,7 @@ gfx_ZeroScreen:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetPalette:
 ; Sets the palette colors
 ; Arguments:
@@ -578,6 +664,7 @@ assert mpLcdPalette and 1 = 0
 	jp	(iy)
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetPixel:
 ; Gets the color index of a pixel
 ; Arguments:
@@ -614,6 +701,7 @@ _GetPixel:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetPixel:
 ; Sets the color pixel to the global color index
 ; Arguments:
@@ -647,6 +735,7 @@ smcByte _Color
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FillRectangle:
 ; Draws a clipped rectangle with the global color index
 ; Arguments:
@@ -709,6 +798,9 @@ _FillRectangle_NoClip:
 	ld	de,(CurrentBuffer)
 	add	hl,de
 	ex	de,hl			; de -> place to begin drawing
+	ld	hl,-FillRectangle_PushWidth
+	add	hl,bc
+	jr	c,_FillRectangle_Push	; push wide rows
 	push	de
 	ld	(.width1),bc
 	ld	(.width2),bc
@@ -744,7 +836,101 @@ _FillRectangle_NoClip:
 	jr	nz,.loop
 	ret
 
+FillRectangle_PushWidth  := 64		; narrower rows are faster with ldir
+FillRectangle_MaxPushes  := LcdWidth/3
+
+_FillRectangle_Push:
+; Fills a wide rectangle by pushing each of its rows from the end, with a push
+; run in the cursor ram like gfx_FillScreen. Unlike the screen, a row has pixels
+; of other rectangles under it, so interrupts are held off while sp is in a row
+; instead of leaving room for their stack.
+; Inputs:
+;  a  : Height
+;  bc : Width
+;  de : Pointer to top left corner
+	call	_BorrowCursorRam
+	ld	iy,0
+	add	iy,sp			; iy = original sp
+	ld	(.sp),iy
+	push	af			; save height
+	ld	h,c
+	ld	l,171
+	mlt	hl			; hl = (width & 255) * 171
+	ld	a,b
+	or	a,a
+	ld	a,h
+	jr	z,.third
+	add	a,171			; add 256 * 171
+.third:
+	rra				; a = width * 171 / 512 = width / 3 (width < 512)
+	ld	l,a
+	ld	h,3
+	mlt	hl
+	ld	h,a			; h = pushes per row
+	ld	a,c
+	sub	a,l			; a = width % 3
+	neg
+	ld	(.remainder),a
+	ex	de,hl
+	add	hl,bc
+	ld	(.end),hl		; end (exclusive) of first row
+	ex	de,hl
+	ld	a,h
+	ld	hl,_FillRectangle_FastCode_Dest
+	ld	(hl),$E1		; pop hl
+	inc	hl
+	ld	(hl),$D5		; push de
+	push	hl
+	pop	de
+	inc	de
+	ld	bc,0
+	ld	c,a
+	dec	c
+	ldir				; fill push run
+	ld	a,$E9
+	ld	(de),a			; jp (hl)
+	ld	a,$FB			; ei
+	ld	hl,.ei
+	ld	(hl),a
+	ld	a,i			; p/v = interrupts enabled
+	jp	pe,.enabled
+	ld	(hl),0			; nop
+.enabled:
+	ld	a,(_Color)
+	ld	d,a
+	ld	e,a
+	push	de
+	dec	sp
+	pop	de			; deu = color
+	inc	sp
+	ld	e,a			; de = color in every byte
+	ld	iy,0
+.end = $-3				; iy = end of current row
+	pop	af			; a = height
+	wait_quick
+.row:
+	ld	(iy-1),e		; write the bytes left of width / 3 pushes,
+	ld	(iy-2),e		; or bytes about to be pushed over anyway
+	lea	hl,iy+0
+.remainder = $-1
+	di
+	ld	sp,hl
+	call	_FillRectangle_FastCode_Dest ; push row
+	ld	sp,0
+.sp = $-3
+.ei:
+	ei				; nop if interrupts were disabled
+	ld	bc,LcdWidth
+	add	iy,bc
+	dec	a
+	jr	nz,.row
+	jp	_ReturnCursorRam
+
+_FillRectangle_FastCode_Dest := mpLcdCrsrImage
+assert FillRectangle_MaxPushes+2 <= CursorRamBorrowed
+
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Rectangle:
 ; Draws an clipped rectangle outline with the global color index
 ; Arguments:
@@ -796,6 +982,7 @@ gfx_Rectangle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Rectangle_NoClip:
 ; Draws an unclipped rectangle outline with the global color index
 ; Arguments:
@@ -829,6 +1016,7 @@ gfx_Rectangle_NoClip:
 	jp	_HorizLine_NoClip_Draw	; draw bottom horizontal line
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_HorizLine:
 ; Draws an clipped horizontal line with the global color index
 ; Arguments:
@@ -908,6 +1096,7 @@ smcByte _Color
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_VertLine:
 ; Draws an clipped vertical line with the global color index
 ; Arguments:
@@ -983,6 +1172,7 @@ smcByte _Color
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetDraw:
 ; Forces drawing routines to operate on the offscreen buffer
 ; or to operate on the visible screen
@@ -1011,6 +1201,7 @@ gfx_SetDraw:
 	jr	.set
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetDraw:
 ; Gets the current drawing state
 ; Arguments:
@@ -1023,6 +1214,7 @@ gfx_GetDraw:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _WaitQuick:
 	ex	(sp),hl			; hl saved, hl = return vector
 	push	de			; de saved
@@ -1136,6 +1328,7 @@ assert .LcdSizeH and lcdIntLNBU
 	jr	_WriteWaitQuickSMC
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Circle:
 ; Draws a clipped circle outline
 ; Arguments:
@@ -1269,6 +1462,7 @@ gfx_Circle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FillCircle:
 ; Draws an clipped circle
 ; Arguments:
@@ -1398,6 +1592,7 @@ gfx_FillCircle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FillCircle_NoClip:
 ; Draws an unclipped circle
 ; Arguments:
@@ -1517,6 +1712,7 @@ _ResetStack:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Line:
 ; Draws an arbitrarily clipped line
 ; Arguments:
@@ -1770,6 +1966,7 @@ smcByte _Color
 	jr	dl_vloop
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Blit:
 ; Copies the buffer image to the screen and vice versa
 ; Arguments:
@@ -1821,6 +2018,7 @@ gfx_BlitLines:
 	jr	util.blit
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_BlitRectangle:
 ; Copies the buffer image to the screen and vice versa rectangularly
 ; Arguments:
@@ -1875,6 +2073,7 @@ gfx_BlitRectangle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_CopyRectangle:
 ; Copies a rectangle between graphics buffers or to the same graphics buffer.
 ; Arguments:
@@ -1941,6 +2140,225 @@ gfx_CopyRectangle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
+gfx_SetCursorImage:
+; Uploads and selects the image of the hardware cursor
+; Arguments:
+;  arg0 : Pointer to 2bpp image, or NULL to only select it
+;  arg1 : Index of 32x32 image
+;  arg2 : Size of image
+; Returns:
+;  None
+	ld	iy,0
+	add	iy,sp
+	ld	a,(iy+9)
+	and	a,1
+	ld	(mpLcdCrsrConfig),a	; 32x32 or 64x64, not frame synced
+	ld	bc,CursorImageSize32
+	ld	a,(iy+6)
+	and	a,3			; a = index
+	jr	z,.first
+	bit	0,(iy+9)
+	jr	z,.small
+.first:
+	ld	hl,_BorrowCursorRam
+	ld	(hl),0			; fast fills now have to save the image
+	ld	hl,_ReturnCursorRam
+	ld	(hl),0
+	xor	a,a
+.small:
+	bit	0,(iy+9)
+	jr	z,.select
+	ld	bc,CursorImageSize64
+.select:
+	ld	e,a
+	add	a,a
+	add	a,a
+	add	a,a
+	add	a,a
+	ld	d,a			; d = index << 4
+	ld	hl,mpLcdCrsrCtrl
+	ld	a,(hl)
+	and	a,not $30
+	or	a,d
+	ld	(hl),a			; select image
+	ld	hl,mpLcdCrsrImage
+	ld	a,h
+	add	a,e
+	ld	h,a			; hl = mpLcdCrsrImage + index * 256
+	ex	de,hl
+	ld	hl,(iy+3)
+	add	hl,bc
+	or	a,a
+	sbc	hl,bc
+	ret	z			; only select
+	ldir
+	ret
+
+CursorImageSize32 := 32*32/4
+CursorImageSize64 := 64*64/4
+assert mpLcdCrsrImage and $FF = 0
+assert CursorImageSize32*4 = CursorImageSize64
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_SetCursorColors:
+; Sets the two colors of the hardware cursor from the palette
+; Arguments:
+;  arg0 : Color index of cursor color 0
+;  arg1 : Color index of cursor color 1
+; Returns:
+;  None
+	ld	iy,0
+	add	iy,sp
+	ld	a,(iy+3)
+	ld	de,mpLcdCrsrPalette0
+	call	.convert
+	ld	a,(iy+6)
+	ld	de,mpLcdCrsrPalette1
+.convert:
+; converts a 1555 palette entry into the 888 cursor palette
+assert mpLcdPalette and 1 = 0
+	ld	hl,mpLcdPalette shr 1
+	ld	l,a
+	add	hl,hl			; hl = &palette[index]
+	ld	c,(hl)
+	inc	hl
+	ld	b,(hl)			; bc = entry
+	ld	a,c
+	and	a,$1F			; a = low component
+	call	.expand5
+	ld	(de),a
+	inc	de
+	ld	a,c
+	rlca
+	rlca
+	rlca
+	and	a,7
+	ld	l,a
+	ld	a,b
+	and	a,3
+	rlca
+	rlca
+	rlca
+	or	a,l
+	add	a,a
+	bit	7,b
+	jr	z,.green
+	inc	a			; a = green with its low bit
+.green:
+	ld	l,a
+	add	a,a
+	add	a,a
+	srl	l
+	srl	l
+	srl	l
+	srl	l
+	or	a,l
+	ld	(de),a
+	inc	de
+	ld	a,b
+	rrca
+	rrca
+	and	a,$1F			; a = high component
+	call	.expand5
+	ld	(de),a
+	ret
+.expand5:
+	ld	l,a
+	add	a,a
+	add	a,a
+	add	a,a
+	srl	l
+	srl	l
+	or	a,l
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_SetCursorPosition:
+; Moves the hardware cursor, clipping it against the left and top of the screen
+; Arguments:
+;  arg0 : X coordinate
+;  arg1 : Y coordinate
+; Returns:
+;  None
+	ld	iy,0
+	add	iy,sp
+	ld	a,(mpLcdCrsrConfig)
+	rrca
+	ld	c,32			; c = cursor size
+	jr	nc,.size
+	ld	c,64
+.size:
+	ld	hl,(iy+3)
+	call	.clip
+	ld	(mpLcdCrsrXY),hl
+	ld	b,a			; b = pixels clipped on the left
+	ld	hl,(iy+6)
+	call	.clip
+	ld	(mpLcdCrsrXY+2),hl
+	ld	h,a
+	ld	l,b
+	ld	(mpLcdCrsrClip),hl
+	ret
+.clip:
+; Inputs:
+;  hl : Coordinate
+;  c : Cursor size
+; Outputs:
+;  hl : Cursor position
+;  a : Pixels clipped
+	ld	de,$1000		; range of the position registers
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	ld	a,0
+	ret	c			; on screen, or clipped by the lcd
+	ld	de,0
+	ld	e,c
+	dec	e
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	jr	nc,.offscreen		; not partly on screen
+	ld	a,e
+	sub	a,l			; a = -coordinate
+	or	a,a
+	sbc	hl,hl
+	ret
+.offscreen:
+	ld	hl,$FFF
+	xor	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_ShowCursor:
+; Shows the hardware cursor
+; Arguments:
+;  None
+; Returns:
+;  None
+	ld	hl,mpLcdCrsrCtrl
+	set	0,(hl)
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_HideCursor:
+; Hides the hardware cursor
+; Arguments:
+;  None
+; Returns:
+;  None
+	ld	hl,mpLcdCrsrCtrl
+	res	0,(hl)
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
 gfx_ShiftLeft:
 ; Shifts whatever is in the clip left by some pixels
 ; Arguments:
@@ -2049,6 +2467,7 @@ ShiftLineOff :=$+1
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetClipRegion:
 ; Arguments:
 ;  Pointer to struct
@@ -2066,6 +2485,7 @@ gfx_GetClipRegion:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ScaledSprite_NoClip:
 ; Draws a scaled sprite to the screen
 ; Arguments:
@@ -2165,6 +2585,7 @@ NcSprHscl320:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ScaledTransparentSprite_NoClip:
 ; Draws a scaled sprite to the screen with transparency
 ; Arguments:
@@ -2247,6 +2668,7 @@ smcByte _TransparentColor
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_TransparentSprite:
 ; Draws a transparent sprite with clipping
 ; Arguments:
@@ -2339,6 +2761,7 @@ _TransparentPlot:
 	jr	_TransparentPlot_Opaque
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Sprite:
 ; Places an sprite on the screen as fast as possible with clipping
 ; Arguments:
@@ -2383,6 +2806,7 @@ gfx_Sprite:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Sprite_NoClip:
 ; Places an sprite on the screen as fast as possible
 ; Arguments:
@@ -2435,6 +2859,7 @@ gfx_Sprite_NoClip:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetSprite:
 ; Grabs the data from the current draw buffer and stores it in another buffer
 ; Arguments:
@@ -2486,6 +2911,7 @@ gfx_GetSprite:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_TransparentSprite_NoClip:
 ; Draws a transparent sprite to the current buffer
 ; Arguments:
@@ -2530,6 +2956,7 @@ smcByte _TransparentColor
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _ClipCoordinates:
 ; Clipping stuff
 ; Arguments:
@@ -2648,6 +3075,7 @@ _ClipCoordinates:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_TransparentTilemap_NoClip:
 ; Tilemapping subsection
 	ld	hl,gfx_TransparentSprite_NoClip
@@ -2857,6 +3285,7 @@ _Tilemap:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_TilePtr:
 ; Returns a pointer to a tile given the pixel offsets
 ; Arguments:
@@ -2916,6 +3345,7 @@ gfx_TilePtr:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_TilePtrMapped:
 ; Returns a direct pointer to the input tile
 ; Arguments:
@@ -2940,6 +3370,7 @@ gfx_TilePtrMapped:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetTextX:
 ; Gets the X position of the text cursor
 ; Arguments:
@@ -2950,6 +3381,7 @@ gfx_GetTextX:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetTextY:
 ; Gets the Y position of the text cursor
 ; Arguments:
@@ -2960,6 +3392,7 @@ gfx_GetTextY:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextXY:
 ; Sets the text X and Y positions
 ; Arguments:
@@ -2982,6 +3415,7 @@ _indcallHL:
 	jp	(hl)
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextBGColor:
 ; Sets the background text color for text routines
 ; Arguments:
@@ -2991,6 +3425,7 @@ gfx_SetTextBGColor:
 	setSmcBytes _TextBGColor
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextFGColor:
 ; Sets the foreground text color for text routines
 ; Arguments:
@@ -3000,6 +3435,7 @@ gfx_SetTextFGColor:
 	setSmcBytes _TextFGColor
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextTransparentColor:
 ; Sets the transparency text color for text routines
 ; Arguments:
@@ -3009,6 +3445,7 @@ gfx_SetTextTransparentColor:
 	setSmcBytes _TextTPColor
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetFontHeight:
 ; Sets the height of the font in pixels
 ; Arguments:
@@ -3018,6 +3455,7 @@ gfx_SetFontHeight:
 	setSmcBytes _TextHeight
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_PrintStringXY:
 ; Places a string at the given coordinates
 ; Arguments:
@@ -3046,15 +3484,10 @@ gfx_PrintString:
 	ex	(sp),hl
 	push	de
 _DrawCharacters:
-	ld	a,(hl)			; get the current character
-	or	a,a
-	ret	z
-	call	_PrintChar
-PrintChar_2 = $-3
-	inc	hl			; move to the next one
-	jr	_DrawCharacters
+	jp	_DrawString
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextScale:
 ; Changes the amount of text scaling (note that height and width are independent)
 ; Arguments:
@@ -3095,6 +3528,7 @@ gfx_SetTextScale:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetTextConfig:
 ; Configures text depending on the arguments
 ; Arguments:
@@ -3111,11 +3545,11 @@ gfx_SetTextConfig:
 	ld	hl,_PrintChar
 .writesmc:				; hl = PrintChar routine
 	ld	(PrintChar_0),hl
-	ld	(PrintChar_1),hl
 	ld	(PrintChar_2),hl
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_PrintChar:
 ; Places a character at the current cursor position
 ; Arguments:
@@ -3264,6 +3698,7 @@ smcByte _TextTPColor
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _PrintChar_Clip:
 ; Clipped text for characters printing routine
 ; Arguments:
@@ -3318,6 +3753,271 @@ smcByte _TextHeight
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
+_DrawString:
+; Draws a string at the current cursor position. Unscaled strings that need no
+; clipping are drawn by _DrawStringFast, others a character at a time.
+; Inputs:
+;  hl : Pointer to string
+; Outputs:
+;  None
+	ld	a,(_TextScaleJump)
+	or	a,a
+	jr	nz,.chars		; scaled text
+	ld	a,(_TextTPColor)
+	ld	c,a
+	ld	a,(_TextFGColor)
+	cp	a,c
+	jr	z,.chars		; transparent foreground
+	ld	a,(_TextHeight)
+	or	a,a
+	jr	z,.chars
+	push	hl
+	ld	hl,(PrintChar_2)
+	ld	de,_PrintChar
+	or	a,a
+	sbc	hl,de
+	pop	hl
+	jr	z,_DrawStringFast	; text is not clipped
+	call	_StringInClip
+	jr	c,_DrawStringFast	; string is entirely inside the clip region
+.chars:
+	ld	a,(hl)			; get the current character
+	or	a,a
+	ret	z
+	call	_PrintChar
+PrintChar_2 = $-3
+	inc	hl			; move to the next one
+	jr	.chars
+
+;-------------------------------------------------------------------------------
+_DrawStringFast:
+; Draws an unscaled string without clipping, computing the colors, position and
+; row stride once for the whole string. Glyph rows are drawn by jumping into an
+; unrolled run of 8 pixels, opaque or with a transparent background.
+; Characters wider than 8 pixels are drawn by _PrintChar instead.
+; Inputs:
+;  hl : Pointer to string
+; Outputs:
+;  None
+	push	ix
+	ld	(.string),hl
+	ld	a,(_TextTPColor)
+	ld	c,a
+	ld	a,(_TextBGColor)
+	cp	a,c
+	jr	z,.transparentbg
+	ld	l,a			; l = background
+	ld	a,(_TextFGColor)
+	xor	a,l
+	ld	h,a			; h = foreground ^ background
+	ld	bc,.opaqueEnd
+	ld	a,(.opaqueEnd-.opaque)/8
+	jr	.setmode
+.transparentbg:
+	ld	a,(_TextFGColor)
+	ld	l,a			; l = foreground
+	ld	bc,.transparentEnd
+	ld	a,(.transparentEnd-.transparent)/8
+.setmode:
+	ld	(.colors),hl
+	ld	(.runEnd),bc
+	ld	(.pixelSize),a
+	ld	a,(_TextHeight)
+	dec	a
+	or	a,a
+	sbc	hl,hl
+	ld	l,a
+	ld	h,LcdWidth/2
+	mlt	hl
+	add	hl,hl
+	ex	de,hl
+	or	a,a
+	sbc	hl,hl
+	sbc	hl,de
+	ld	(.back),hl		; back from last row to first
+	ld	hl,(_TextYPos)
+	ld	h,LcdWidth/2
+	mlt	hl
+	add	hl,hl
+	ld	bc,(_TextXPos)
+	add	hl,bc
+	ld	bc,(CurrentBuffer)
+	add	hl,bc
+	ld	(.start),hl
+	ex	de,hl			; de = draw location
+	wait_quick
+.char:
+	ld	hl,0
+.string := $-3
+	ld	a,(hl)
+	or	a,a
+	jp	z,.done
+	inc	hl
+	ld	(.string),hl
+	sbc	hl,hl
+	ld	l,a			; hl = character
+	push	hl
+	add	hl,hl
+	add	hl,hl
+	add	hl,hl
+	ld	bc,(_TextData)
+	add	hl,bc
+	ex	(sp),hl
+	pop	ix			; ix = glyph
+	ld	a,(_TextFixedWidth)
+	or	a,a
+	jr	nz,.fixed
+	ld	bc,(_CharSpacing)
+	add	hl,bc
+	ld	a,(hl)			; a = char width
+.fixed:
+	cp	a,9
+	jp	nc,.wide
+	push	af
+	ld	bc,0
+	ld	c,a
+	ld	b,0
+.pixelSize := $-1
+	mlt	bc
+	ld	hl,0
+.runEnd := $-3
+	or	a,a
+	sbc	hl,bc
+	ld	(.entry),hl		; enter the run for width pixels
+	ld	a,(_TextHeight)
+	ld	b,a
+	ld	iy,0
+	ld	hl,0
+.colors := $-3
+.row:
+	add	iy,de			; get draw location
+	lea	de,iy
+	ld	c,(ix)			; c = 8 pixels
+	inc	ix
+	ld	a,l
+	jp	0
+.entry := $-3
+.opaque:
+repeat 8
+	sla	c
+	sbc	a,a
+	and	a,h
+	xor	a,l			; a = pixel ? foreground : background
+	ld	(de),a
+	inc	de
+end repeat
+.opaqueEnd:
+	jr	.rowEnd
+.transparent:
+repeat 8
+	sla	c
+	jr	nc,$+3
+	ld	(de),a			; a = foreground
+	inc	de
+end repeat
+.transparentEnd:
+.rowEnd:
+	ld	de,LcdWidth
+	djnz	.row
+	pop	af			; a = char width
+	lea	hl,iy+0
+	ld	de,0
+.back := $-3
+	add	hl,de
+	ld	de,0
+	ld	e,a
+	add	hl,de
+	ex	de,hl			; de = next draw location
+	jp	.char
+.wide:
+	push	de
+	push	af
+	call	.syncpos
+	ld	hl,(.string)
+	dec	hl
+	ld	a,(hl)			; a = character
+	call	_PrintChar		; draw it the slow way
+	pop	af
+	pop	hl
+	ld	bc,0
+	ld	c,a
+	add	hl,bc
+	ld	(.start),hl		; _PrintChar moved the text position
+	ex	de,hl			; de = next draw location
+	jp	.char
+.done:
+	call	.syncpos
+	pop	ix
+	ret
+.syncpos:
+	ex	de,hl
+	ld	bc,0
+.start := $-3
+	or	a,a
+	sbc	hl,bc
+	ld	bc,(_TextXPos)
+	add	hl,bc
+	ld	(_TextXPos),hl		; move past the characters drawn from start
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
+_StringInClip:
+; Checks if an unscaled string is entirely inside the clip region
+; Inputs:
+;  hl : Pointer to string
+; Outputs:
+;  c if it is
+;  hl preserved
+	push	hl
+	ld	de,0
+.width:
+	ld	a,(hl)
+	or	a,a
+	jr	z,.x
+	push	hl
+	call	_GetCharWidth
+	ex	de,hl
+	pop	hl
+	inc	hl
+	jr	.width
+.x:
+	ld	hl,(_TextXPos)
+	ld	bc,(_XMin)
+	or	a,a
+	sbc	hl,bc
+	jp	m,.outside
+	add	hl,bc
+	add	hl,de			; hl = x + width
+	ld	bc,(_XMax)
+	scf
+	sbc	hl,bc
+	jp	p,.outside
+	ld	hl,(_TextYPos)
+	ld	bc,(_YMin)
+	or	a,a
+	sbc	hl,bc
+	jp	m,.outside
+	add	hl,bc
+	ld	de,0
+	ld	a,(_TextHeight)
+	ld	e,a
+	add	hl,de			; hl = y + height
+	ld	bc,(_YMax)
+	scf
+	sbc	hl,bc
+	jp	p,.outside
+	pop	hl
+	scf
+	ret
+.outside:
+	pop	hl
+	or	a,a
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
 gfx_PrintInt:
 ; Places an int at the current cursor position
 ; Arguments:
@@ -3347,6 +4047,8 @@ gfx_PrintUInt:
 	push	bc
 	push	hl
 	push	de
+	ld	de,_IntString
+	ld	(.next),de
 	jr	nc,.begin		; c ==> actually a negative int
 	ex	de,hl
 	or	a,a
@@ -3373,6 +4075,11 @@ gfx_PrintUInt:
 	ld	de,-10
 	call	.num1
 	ld	de,-1
+	call	.num1
+	ld	hl,(.next)
+	ld	(hl),0
+	ld	hl,_IntString
+	jp	_DrawString		; draw the digits as a string
 .num1:
 	xor	a,a
 .num2:
@@ -3393,13 +4100,17 @@ gfx_PrintUInt:
 	add	a,'0'
 	ld	c,a			; mark that a digit has been printed
 .printchar:
-	push	bc
-	call	_PrintChar
-PrintChar_1 := $-3
-	pop	bc
+	push	hl
+	ld	hl,0
+.next := $-3
+	ld	(hl),a
+	inc	hl
+	ld	(.next),hl
+	pop	hl
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetStringWidth:
 ; Gets the width of a string
 ; Arguments:
@@ -3426,6 +4137,7 @@ gfx_GetStringWidth:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetCharWidth:
 ; Gets the width of a character
 ; Arguments:
@@ -3454,6 +4166,7 @@ _GetCharWidth:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_GetSpriteChar:
 ; Sets the data in char_sprite (must have previously allocated an 8x8 width sprite)
 ; the pixel map of the character c
@@ -3499,6 +4212,7 @@ smcByte _TextHeight
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _GetChar:
 ; Places a character data into a nice buffer
 ; Inputs:
@@ -3540,6 +4254,7 @@ smcByte _TransparentColor
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetFontData:
 ; Sets the font to be custom
 ; Arguments:
@@ -3563,6 +4278,7 @@ gfx_SetFontData:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetCharData:
 ; Sets a custom font for a specific character
 ; Arguments:
@@ -3592,6 +4308,7 @@ gfx_SetCharData:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetFontSpacing:
 ; Sets the font to be custom spacing
 ; Arguments:
@@ -3613,6 +4330,7 @@ gfx_SetFontSpacing:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_SetMonospaceFont:
 ; Sets the font to be monospace
 ; Arguments:
@@ -3628,6 +4346,7 @@ gfx_SetMonospaceFont:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FillTriangle_NoClip:
 ; Draws a filled triangle without clipping
 ; Arguments:
@@ -3957,6 +4676,7 @@ _FillTriangle:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Polygon_NoClip:
 ; Draws a clipped polygon outline
 ; Arguments:
@@ -4027,11 +4747,256 @@ _Polygon:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
+gfx_Polyline:
+; Draws clipped lines through a list of points
+; Arguments:
+;  arg0 : Pointer to points
+;  arg1 : Number of points
+;  arg2 : Nonzero to also draw a line from the last point to the first
+; Returns:
+;  None
+	push	ix
+	ld	ix,0
+	add	ix,sp
+	lea	hl,ix-LineSegmentLocals
+	ld	sp,hl			; sp = line arguments
+	ld	hl,(ix+9)
+	add	hl,bc
+	or	a,a
+	sbc	hl,bc
+	jr	z,.done			; no points
+	ld	iy,(ix+6)
+	ld	(ix-6),iy		; first point
+	ld	hl,(iy+0)
+	ld	de,(iy+3)
+	call	_ComputeOutcode
+	ld	(ix-3),a		; outcode of the previous point
+	ld	(ix-2),a		; outcode of the first point
+.loop:
+	ld	hl,(ix+9)
+	dec	hl
+	ld	(ix+9),hl
+	add	hl,bc
+	or	a,a
+	sbc	hl,bc
+	jr	z,.last
+	ld	iy,(ix+6)
+	ld	hl,(iy+0)
+	ld	(ix-LineSegmentLocals+0),hl
+	ld	hl,(iy+3)
+	ld	(ix-LineSegmentLocals+3),hl
+	lea	iy,iy+6
+	ld	(ix+6),iy
+	ld	hl,(iy+0)
+	ld	(ix-LineSegmentLocals+6),hl
+	ld	de,(iy+3)
+	ld	(ix-LineSegmentLocals+9),de
+	call	_ComputeOutcode
+	ld	c,a			; c = outcode of this point
+	ld	b,(ix-3)		; b = outcode of the previous point
+	ld	(ix-3),a
+	call	_LineSegment
+	jr	.loop
+.last:
+	ld	a,(ix+12)
+	or	a,a
+	jr	z,.done			; not closed
+	ld	iy,(ix+6)
+	ld	hl,(iy+0)
+	ld	(ix-LineSegmentLocals+0),hl
+	ld	hl,(iy+3)
+	ld	(ix-LineSegmentLocals+3),hl
+	ld	iy,(ix-6)
+	ld	hl,(iy+0)
+	ld	(ix-LineSegmentLocals+6),hl
+	ld	hl,(iy+3)
+	ld	(ix-LineSegmentLocals+9),hl
+	ld	b,(ix-3)
+	ld	c,(ix-2)
+	call	_LineSegment
+.done:
+	ld	sp,ix
+	pop	ix
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_Lines:
+; Draws clipped lines between pairs of points
+; Arguments:
+;  arg0 : Pointer to pairs of points
+;  arg1 : Number of lines
+; Returns:
+;  None
+	push	ix
+	ld	ix,0
+	add	ix,sp
+	lea	hl,ix-LineSegmentLocals
+	ld	sp,hl			; sp = line arguments
+	jr	.next
+.loop:
+	ld	iy,(ix+6)
+	ld	hl,(iy+0)
+	ld	(ix-LineSegmentLocals+0),hl
+	ld	de,(iy+3)
+	ld	(ix-LineSegmentLocals+3),de
+	call	_ComputeOutcode
+	ld	(ix-3),a		; outcode of the first point
+	ld	hl,(iy+6)
+	ld	(ix-LineSegmentLocals+6),hl
+	ld	de,(iy+9)
+	ld	(ix-LineSegmentLocals+9),de
+	call	_ComputeOutcode
+	ld	c,a
+	ld	b,(ix-3)
+	lea	iy,iy+12
+	ld	(ix+6),iy
+	call	_LineSegment
+.next:
+	ld	hl,(ix+9)
+	add	hl,bc
+	or	a,a
+	sbc	hl,bc
+	jr	z,.done
+	dec	hl
+	ld	(ix+9),hl
+	jr	.loop
+.done:
+	ld	sp,ix
+	pop	ix
+	ret
+
+; outcodes and first point above the line arguments
+LineSegmentLocals := 6+12
+
+;-------------------------------------------------------------------------------
+	extract_section
+_LineSegment:
+; Draws a line of gfx_Polyline or gfx_Lines with the outcodes of its points
+; already computed, so they are computed once per point
+; Inputs:
+;  (sp+3) : Line arguments, as for gfx_Line
+;  b : Outcode of first point
+;  c : Outcode of second point
+; Outputs:
+;  None
+	ld	a,b
+	and	a,c
+	ret	nz			; trivially rejected
+	ld	a,b
+	or	a,c
+	jp	z,gfx_Line_NoClip	; trivially accepted
+	ld	iy,0
+	add	iy,sp
+	push	hl			; temp storage, as in gfx_Line
+	ld	(iy-1),b
+	ld	(iy-2),c
+	jp	CohenSutherlandLoop
+
+;-------------------------------------------------------------------------------
+	extract_section
+gfx_Pixels:
+; Draws a list of pixels clipped against the clip region
+; Arguments:
+;  arg0 : Pointer to points
+;  arg1 : Number of points
+;  arg2 : Pointer to a color index for each point, or NULL for the global color
+; Returns:
+;  None
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(_XMin)
+	ld	de,(_XMax)
+	or	a,a
+	sbc	hl,de
+	ret	z			; empty clip region
+	ld	(.width),hl		; xmin - xmax
+	ld	hl,(_YMin)
+	ld	de,(_YMax)
+	or	a,a
+	sbc	hl,de
+	ret	z
+	ld	(.height),hl		; ymin - ymax
+	ld	de,(_XMin)
+	or	a,a
+	sbc	hl,hl
+	sbc	hl,de
+	ld	(.xmin),hl		; -xmin
+	ld	de,(_YMin)
+	or	a,a
+	sbc	hl,hl
+	sbc	hl,de
+	ld	(.ymin),hl		; -ymin
+	ld	hl,(CurrentBuffer)
+	ld	(.buffer),hl
+	ld	a,$03			; inc bc
+	ld	bc,(iy+9)
+	sbc	hl,hl
+	adc	hl,bc
+	jr	nz,.colors
+	ld	bc,_Color
+	xor	a,a			; nop
+.colors:
+	ld	(.next),a
+	ld	hl,(iy+6)
+	ld	de,0
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	ret	z			; no points
+	push	ix
+	push	hl
+	pop	ix			; ix = number of points
+	ld	iy,(iy+3)		; iy = points
+	wait_quick
+.loop:
+	ld	hl,(iy+0)
+	ld	de,0
+.xmin := $-3
+	add	hl,de
+	ld	de,0
+.width := $-3
+	add	hl,de
+	jr	c,.skip			; x is outside of the clip region
+	ld	hl,(iy+3)
+	ld	de,0
+.ymin := $-3
+	add	hl,de
+	ld	de,0
+.height := $-3
+	add	hl,de
+	jr	c,.skip			; y is outside of the clip region
+	ld	de,(iy+3)
+	ld	d,LcdWidth/2
+	mlt	de
+	ld	hl,(iy+0)
+	add	hl,de
+	add	hl,de
+	ld	de,0
+.buffer := $-3
+	add	hl,de
+	ld	a,(bc)
+	ld	(hl),a
+.skip:
+.next:
+	inc	bc			; nop for the global color
+	lea	iy,iy+6
+	dec	ix
+	ld	a,ixl
+	or	a,ixh
+	jr	nz,.loop
+	pop	ix
+	ret
+
+;-------------------------------------------------------------------------------
+	extract_section
 gfx_Reserved:
 ; Deprecated unused function (available for use)
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_Deprecated:
 ; Decompresses a sprite that is LZ77 compressed from ConvPNG (Deprecated)
 	ld	hl,-23
@@ -4143,6 +5108,7 @@ d_18:	ld	bc,(ix-17)
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FlipSpriteY:
 ; Flips an array horizontally about the center vertical axis
 ; Arguments:
@@ -4191,6 +5157,7 @@ gfx_FlipSpriteY:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FlipSpriteX:
 ; Flip a sprite vertically about the center horizontal axis
 ; Arguments:
@@ -4234,6 +5201,7 @@ gfx_FlipSpriteX:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RotateSpriteC:
 ; Rotates an array 90 degress clockwise
 ; Arguments:
@@ -4275,6 +5243,7 @@ gfx_RotateSpriteC:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RotateSpriteCC:
 ; Rotates a sprite 90 degrees counter clockwise
 ; Arguments:
@@ -4315,6 +5284,7 @@ gfx_RotateSpriteCC:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RotateSpriteHalf:
 ; Rotates an array 180 degrees
 ; Arguments:
@@ -4343,6 +5313,7 @@ gfx_RotateSpriteHalf:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ScaleSprite:
 ; Scale an image using an output buffer
 ; Arguments:
@@ -4425,6 +5396,7 @@ dv_shr_8_times_width_plus_width := $-3
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RotatedScaledSprite_NoClip:
 ; Rotate and scale an image drawn directly to the screen buffer
 ; Arguments:
@@ -4667,6 +5639,7 @@ smcByte _TransparentColor
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RotateScaleSprite:
 ; Rotate and scale an image using an output buffer
 ; Arguments:
@@ -4952,6 +5925,7 @@ _16Mul16SignedNeg:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_FloodFill:
 ; Implements a flood fill so no one hopefully crashes the stack
 ; Maximum stack depth is 3224 bytes
@@ -5226,6 +6200,7 @@ gfx_FloodFill:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_RLETSprite:
 ; Draws a sprite with RLE transparency with clipping.
 ; Arguments:
@@ -5583,6 +6558,7 @@ _RLETSprite_NoClip_LoopJr_SMC := $-1
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ConvertFromRLETSprite:
 ; Converts a sprite with RLE transpareny to a sprite with normal transparency.
 ; Arguments:
@@ -5648,6 +6624,7 @@ _ConvertFromRLETSprite_RowEnd:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 gfx_ConvertToNewRLETSprite:
 ; Converts a sprite with normal transpareny to a sprite with RLE transparency,
 ; allocating the exact amount of necessary space for the converted sprite.
@@ -5804,6 +6781,7 @@ _ConvertToRLETSprite_RowEnd:
 ;-------------------------------------------------------------------------------
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _LZ_ReadVarSize:
 ; LZ Decompression Subroutine (DEPRECATED)
 	push	ix
@@ -5863,6 +6841,7 @@ _LZ_ReadVarSize:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _Maximum:
 ; Calculate the resut of a signed comparison
 ; Inputs:
@@ -5881,6 +6860,7 @@ _Maximum:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _Minimum:
 ; Calculate the resut of a signed comparison
 ; Inputs:
@@ -5899,6 +6879,7 @@ _Minimum:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _ClipRegion:
 ; Calculates the new coordinates given the clip  and inputs
 ; Inputs:
@@ -5937,6 +6918,7 @@ _SignedCompare:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _UCDivA:
 	sbc	hl,hl
 	ld	h,a
@@ -5958,6 +6940,7 @@ _UCDivA:
 	ret				; ca = c*256/a, h = c*256%a
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _DivideHLBC:
 ; Performs signed interger division
 ; Inputs:
@@ -6005,6 +6988,7 @@ _DivideHLBC:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _MultiplyHLDE:
 ; Performs (un)signed integer multiplication
 ; Inputs:
@@ -6068,6 +7052,7 @@ _MultiplyHLBC:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _ComputeOutcode:
 ; Compute the bitcode for a point (x, y) using the clip rectangle
 ; bounded diagonally by (xmin, ymin), and (xmax, ymax)
@@ -6112,6 +7097,7 @@ _ComputeOutcode:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 util.getbuffer:
 	ld	hl,vram + LcdSize
 	ld	de,(mpLcdBase)
@@ -6127,6 +7113,7 @@ util.getbuffer:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _ShiftCalculate:
 	ld	(ShiftCopyDirection),a
 	sbc	a,a
@@ -6141,6 +7128,7 @@ _ShiftCalculate:
 	ret
 
 ;-------------------------------------------------------------------------------
+	extract_section
 _SetSmcBytes:
 	pop	hl
 	pop	de
@@ -6150,13 +7138,11 @@ _SetSmcBytes:
 	ld	b,(hl)
 .loop:
 	inc	hl
-	ld	e,(hl)
+	ld	de,(hl)			; de = smc site
 	inc	hl
-	ld	d,(hl)
+	inc	hl
+	ld	a,(de)
 	ex	de,hl
-	inc.s	hl
-	add	hl,de
-	ld	a,(hl)
 	ld	(hl),c
 	ex	de,hl
 	djnz	.loop
@@ -6168,6 +7154,7 @@ _SetSmcBytes:
 ; Internal library data
 ;-------------------------------------------------------------------------------
 
+	extract_section
 _CharSpacing:
 	dl	_DefaultCharSpacing
 _TextData:
@@ -6348,6 +7335,9 @@ _ClipRegion_Full:
 _TmpWidth:
 	dl	0,0,0
 
+_IntString:
+	db	0,0,0,0,0,0,0,0,0,0	; sign, 8 digits and null
+
 _TmpCharSprite:
 	db	8,8
 _TmpCharData:
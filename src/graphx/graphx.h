@@ -666,6 +666,8 @@ void gfx_Rectangle_NoClip(uint24_t x,
  * Draws a filled rectangle.
  *
  * This is measured from the top left origin of the screen.
+ * Rectangles at least 64 pixels wide are filled a row at a time with a push
+ * run in the lcd cursor ram, like gfx_FillScreen().
  * @param x X coordinate.
  * @param y Y coordinate.
  * @param width Width of rectangle.
@@ -773,6 +775,39 @@ void gfx_Polygon(int *points, unsigned num_points);
  */
 void gfx_Polygon_NoClip(int *points, unsigned num_points);
 
+/**
+ * Draws clipped lines through a list of points
+ *
+ * Faster than calling gfx_Line() for each pair of points, as the clipping
+ * outcode of each point is computed once, and lines entirely inside or outside
+ * of the clip region skip the clipping.
+ * @param points Pointer to points.
+ * @param num_points Number of points.
+ * @param closed Also draws a line from the last point to the first if true.
+ */
+void gfx_Polyline(const gfx_point_t *points, unsigned num_points, bool closed);
+
+/**
+ * Draws clipped lines between pairs of points
+ *
+ * Line \p i is drawn from \p points[2*i] to \p points[2*i+1], clipped as by
+ * gfx_Polyline().
+ * @param points Pointer to pairs of points.
+ * @param num_lines Number of lines.
+ */
+void gfx_Lines(const gfx_point_t *points, unsigned num_lines);
+
+/**
+ * Draws a list of pixels
+ *
+ * Pixels outside of the clip region are skipped.
+ * @param points Pointer to points.
+ * @param num_points Number of points.
+ * @param colors Pointer to a color index for each point, or NULL to draw them
+ * all with the global color index.
+ */
+void gfx_Pixels(const gfx_point_t *points, unsigned num_points, const uint8_t *colors);
+
 /**
  * Draws a clipped filled triangle.
  *
@@ -938,6 +973,80 @@ void gfx_CopyRectangle(gfx_location_t src,
                        uint24_t width,
                        uint8_t height);
 
+/**
+ * Sizes of hardware cursor images.
+ * @see gfx_SetCursorImage
+ */
+typedef enum {
+    gfx_cursor_32x32 = 0, /**< 32x32 pixels, 4 images fit in the cursor ram. */
+    gfx_cursor_64x64      /**< 64x64 pixels, 1 image fills the cursor ram. */
+} gfx_cursor_size_t;
+
+/**
+ * Pixel values of hardware cursor images.
+ * @see gfx_SetCursorImage
+ */
+typedef enum {
+    gfx_cursor_color0 = 0,     /**< Cursor color 0. */
+    gfx_cursor_color1,         /**< Cursor color 1. */
+    gfx_cursor_transparent,    /**< Shows the pixel below. */
+    gfx_cursor_invert          /**< Inverts the pixel below. */
+} gfx_cursor_pixel_t;
+
+/**
+ * Uploads and selects the image of the hardware cursor.
+ *
+ * The lcd controller draws the cursor over the screen by itself, so it never
+ * has to be erased or redrawn. Images have 2 bits per pixel, each a
+ * gfx_cursor_pixel_t, with the leftmost of every 4 pixels in the lowest bits
+ * of their byte.
+ *
+ * gfx_FillScreen() and gfx_FillRectangle() borrow the first 128 bytes of the
+ * cursor ram. Once an image is uploaded there, they save and restore it, and
+ * its top rows may flicker while they run. Use 32x32 images 1 to 3 to avoid
+ * both, unless the program has a fastcode section: by default it is copied
+ * over images 1 to 3 at startup, and only image 0 can be used along with it.
+ * @param image Image of 256 bytes for 32x32 or 1024 bytes for 64x64, or NULL
+ * to select an image uploaded before.
+ * @param index Index of 32x32 image, 0 to 3. Ignored for 64x64.
+ * @param size Size of image.
+ */
+void gfx_SetCursorImage(const void *image,
+                        uint8_t index,
+                        gfx_cursor_size_t size);
+
+/**
+ * Sets the two colors of the hardware cursor.
+ *
+ * The colors are read from the palette when this is called, so it needs to be
+ * called again after changing those palette entries.
+ * @param index0 Color index for gfx_cursor_color0 pixels.
+ * @param index1 Color index for gfx_cursor_color1 pixels.
+ */
+void gfx_SetCursorColors(uint8_t index0, uint8_t index1);
+
+/**
+ * Moves the hardware cursor.
+ *
+ * The cursor is clipped against the edges of the screen, and hidden when it
+ * is entirely off of it.
+ * @param x X coordinate of the top left of the cursor.
+ * @param y Y coordinate of the top left of the cursor.
+ */
+void gfx_SetCursorPosition(int x, int y);
+
+/**
+ * Shows the hardware cursor.
+ */
+void gfx_ShowCursor(void);
+
+/**
+ * Hides the hardware cursor.
+ *
+ * gfx_End() hides it as well.
+ */
+void gfx_HideCursor(void);
+
 /**
  * Copies the screen to the buffer
  */
@@ -14,10 +14,16 @@
 ;         hl->start of LibLoad
 ; output: once relocation of program and library dependencies is complete,
 ;         jumps to start of program block after relocation block and begins execution
-; uses:   cursorImage, saveSScreen + 19000 and up
+; uses:   cursorImage, saveSScreen + 19000 and up, pixelShadow for libraries with sections
+; cache:  if an appvar named after the program with its first letter in lowercase
+;         exists, it holds the linked import tables and libraries of the program.
+;         it is reused while the program and libraries are unchanged, and is
+;         rewritten after linking otherwise. an empty appvar enables this.
 ; note:   updated size is added to the copy in ram of the program for libraries
 ; notes:  all code is location independent; no need to relocate to absolute address.
 ;         keeping in archive is safe.
+;         readonly library sections are executed in place from the archive, and
+;         are not moved along with it by a garbage collect.
 ;         uses some saferam areas (see below)
 ;=========================================================================
 
@@ -46,6 +52,26 @@ endrelocationtbl           = cursorImage + 983 ; pointer to end of relocation ta
 prgmstart                  = cursorImage + 986 ; pointer to start of actual program when dealing with dependencies
 appvarstartptr             = cursorImage + 989 ; pointer to start of library appvar in archive
 libnameptr                 = cursorImage + 992 ; pointer to name of library to extract
+sectionstate               = cursorImage + 995 ; pointer to section state of the current library, 0 if extracted whole
+sectioncount               = cursorImage + 998 ; number of sections in the library (first of the layout copied into the state)
+sectionmapsize             = cursorImage + 999 ; bytes in a section bitmap
+sectionstarts              = cursorImage + 1000 ; pointer to archived section start offsets
+sectionclosures            = cursorImage + 1003 ; pointer to archived bitmaps of the sections each section needs
+exportsections             = cursorImage + 1006 ; pointer to archived section of each export
+relocsections              = cursorImage + 1009 ; pointer to archived site and target section of each relocation
+readonlysections           = cursorImage + 1012 ; pointer to archived bitmap of sections executed in place
+nextsectionstate           = cursorImage + 1015 ; pointer to free space for section states
+
+neededsections             = pixelShadow + 000 ; bitmap of sections to extract
+sectionstates              = pixelShadow + 032 ; per library: layout, relocation table, code pointers, bitmap of extracted sections, section addresses
+
+; section state offsets
+define statelayout         0
+define staterelocs         17
+define stateendrelocs      20
+define statearclocation    23
+define stateloaded         26
+define stateaddresses      58
 
 ; macro definitions
 define lib_byte            $C0		; library signifier byte
@@ -60,6 +86,8 @@ define prevextracted       0
 define foundprgmstart      1
 define keeplibinarc        2
 define showmsgs            3
+define cacheexists         4
+define cachearchived       5
 
 macro relocate? name, address*
 	name.source? := $
@@ -103,6 +131,8 @@ disable_relocations
 	ld	(endarclibrarylocations),hl
 	ld	hl,dependencyqueuelocation
 	ld	(enddependencyqueue),hl
+	ld	hl,sectionstates
+	ld	(nextsectionstate),hl
 	pop	hl			; restore the pointer to LibLoad
 
 	ld	de,_libloadstart.source
@@ -128,6 +158,9 @@ _startrelocating:
 	push	hl
 	call	_PushOP1		; save program name
 	pop	hl
+	push	hl
+	call	_cacheload		; run the prelinked image of the program if it is still valid
+	pop	hl
 _extractlib:				; hl->NULL terminated libray name string -> $C0,"LIBNAME",0
 	ld	(hl),appVarObj		; change $C0 byte to mark as extracted
 	push	hl
@@ -157,7 +190,7 @@ _nomatch:
 	call	_CpHLDE			; have we reached the end of the table?
 	push	af
 	ex	de,hl
-	ld	de,15			; size of search entry (9=name, 3=ram ptr, 3=arc vec ptr)
+	ld	de,18			; size of search entry (9=name, 3=ram ptr, 3=arc vec ptr, 3=section state ptr)
 	add	hl,de
 	ex	de,hl			; check and see if we have reached the end of the extraction table
 	pop	af
@@ -179,10 +212,20 @@ _donesearch:				; hl->location of library in ram, hl+3->location of library vect
 	inc	hl
 	ld	de,(hl)			; de=location of library in ram
 	ld	(ramlocation),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(hl)			; de=section state of library
+	ld	(sectionstate),de
 	ld	hl,(libnameptr)		; restore pointer to library name
 	call	_movetostrngend		; move to end of library name
 	inc	hl			; bypass version byte
 	ld	(jumptblptr),hl
+	ld	hl,(sectionstate)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jp	nz,_extractsections	; extract any sections this jump table needs that are missing
 	jp	_resloveentrypoints	; need to resolve the entry points & enqueue dependencies
 _notextracted:
 	ld	hl,(libnameptr)
@@ -286,6 +329,11 @@ _goodversion:
 	ld	(ramlocation),hl	; okay, not a ram location, but it's use is still the same
 	set	keeplibinarc,(iy+asmflag)
 _needtoextractlib:
+	or	a,a
+	sbc	hl,hl
+	ld	(sectionstate),hl
+	bit	keeplibinarc,(iy+asmflag)
+	call	z,_findsections		; check if the library can be extracted by sections
 
 	ld	de,(ramlocation)
 	ld	hl,(endarclibrarylocations)
@@ -293,8 +341,19 @@ _needtoextractlib:
 	inc	hl
 	inc	hl
 	inc	hl
+	ld	de,(sectionstate)
+	ld	(hl),de
+	inc	hl
+	inc	hl
+	inc	hl
 	ld	(endarclibrarylocations),hl
 
+	ld	hl,(sectionstate)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jp	nz,_extractsections	; only extract the sections that are used
+
 	bit	keeplibinarc,(iy+asmflag)
 	jr	nz,_resloveentrypoints	; only need to resolve entry points if in the archive
 
@@ -407,6 +466,8 @@ _nosetstart:
 	jp	_extractlib		; extract current dependency if needed, or resolve entry points
 
 _runpgrm:
+	bit	cacheexists,(iy+asmflag)
+	call	nz,_cachesave		; save the linked program for the next launch
 	call	_PopOP1			; restore program name
 	ld	hl,(prgmstart)
 	jp	(hl)			; passed all the checks; let's start execution! :)
@@ -452,6 +513,722 @@ _movetostrngend:
 	cpir
 	ret
 
+_findsections:				; checks for section metadata between the vector table and the dependencies
+	ld	hl,(arclocation)
+	dec	hl
+	ld	a,(hl)
+	cp	a,LIBRARY_SECTIONS_MAGIC
+	ret	nz			; nz: extract the whole library
+	dec	hl
+	dec	hl
+	push	hl			; hl->number of exports, at the end of the metadata
+	call	_LoadDEInd_s		; de=number of exports
+	ld	hl,(vectortblptr)
+	add	hl,de
+	add	hl,de			; hl->section metadata
+	push	de
+	ld	a,(hl)
+	ld	(sectioncount),a
+	add	a,7
+	rra
+	srl	a
+	srl	a
+	ld	(sectionmapsize),a	; (count + 7) / 8
+	inc	hl
+	ld	(sectionstarts),hl
+	ld	de,0
+	ld	a,(sectioncount)
+	ld	e,a
+	inc	de			; start offsets are followed by the end offset
+	add	hl,de
+	add	hl,de
+	ld	(sectionclosures),hl
+	ld	bc,0
+	ld	c,a
+	ld	a,(sectionmapsize)
+	ld	b,a
+	mlt	bc
+	add	hl,bc
+	ld	(readonlysections),hl
+	ld	bc,0
+	ld	c,a
+	add	hl,bc
+	ld	(exportsections),hl
+	pop	de
+	add	hl,de
+	ld	(relocsections),hl
+	ex	de,hl
+	ld	hl,(endrelocationtbl)
+	ld	bc,(relocationtblptr)
+	or	a,a
+	sbc	hl,bc			; two bytes per relocation in both tables
+	add	hl,de
+	pop	de
+	or	a,a
+	sbc	hl,de			; the metadata has to end right at the number of exports
+	ret	nz
+
+	ld	hl,(nextsectionstate)	; allocate the section state
+	ld	(sectionstate),hl
+	ex	de,hl
+	ld	hl,sectioncount
+	ld	bc,staterelocs-statelayout
+	ldir
+	ex	de,hl
+	ld	de,(relocationtblptr)
+	ld	(hl),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(endrelocationtbl)
+	ld	(hl),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(arclocation)
+	ld	(hl),de
+	inc	hl
+	inc	hl
+	inc	hl
+	push	hl
+	ld	bc,stateaddresses-stateloaded
+	call	_MemClear		; no sections extracted yet
+	pop	hl
+	ld	de,stateaddresses-stateloaded
+	add	hl,de
+	ld	de,0
+	ld	a,(sectioncount)
+	ld	e,a
+	add	hl,de
+	add	hl,de
+	add	hl,de
+	ld	(nextsectionstate),hl
+	xor	a,a			; z: extract by sections
+	ret
+
+_extractsections:			; extracts the sections the jump table needs, then resolves it
+	ld	hl,(sectionstate)
+	ld	de,sectioncount
+	ld	bc,staterelocs-statelayout
+	ldir				; restore the layout of the library
+	ld	de,(hl)
+	ld	(relocationtblptr),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(hl)
+	ld	(endrelocationtbl),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(hl)
+	ld	(arclocation),de
+
+	ld	hl,neededsections
+	ld	bc,32
+	call	_MemClear
+	bit	prevextracted,(iy+asmflag)
+	jr	nz,.findneeded
+	xor	a,a
+	call	_needsection		; the first section holds the dependency jump tables
+.findneeded:
+	ld	hl,(jumptblptr)
+.findneededloop:
+	ld	a,(hl)
+	cp	a,jp_byte
+	jr	nz,.findnew
+	inc	hl
+	push	hl
+	ld	hl,(hl)			; offset in vector table (0,3,6, etc.)
+	ld	bc,3
+	call	__idivs			; hl=export index
+	ld	de,(exportsections)
+	add	hl,de
+	ld	a,(hl)
+	call	_needsection		; the section of the function and all it references
+	pop	hl
+	inc	hl
+	inc	hl
+	inc	hl
+	jr	.findneededloop
+
+.findnew:
+	ld	hl,(sectionstate)
+	ld	de,stateloaded
+	add	hl,de
+	ld	de,neededsections
+	ld	a,(sectionmapsize)
+	ld	b,a
+.findnewloop:
+	ld	a,(de)
+	ld	c,(hl)
+	or	a,c
+	ld	(hl),a			; mark as extracted
+	xor	a,c
+	ld	(de),a			; only keep the sections not yet extracted
+	inc	hl
+	inc	de
+	djnz	.findnewloop
+
+	or	a,a
+	sbc	hl,hl
+	ld	(.size),hl
+	ld	c,0
+.sizeloop:
+	call	_isneededsection
+	jr	z,.sizenext
+	call	_isreadonlysection
+	jr	nz,.sizenext		; executed in place from the archive
+	call	_sectionbounds		; de=size of section
+	ld	hl,0
+.size := $-3
+	add	hl,de
+	ld	(.size),hl
+.sizenext:
+	inc	c
+	ld	a,(sectioncount)
+	cp	a,c
+	jr	nz,.sizeloop
+
+	ld	hl,usermem		; sections are extracted to the end of program+libraries
+	ld	de,(asm_prgm_size)
+	add	hl,de
+	ld	(.destination),hl
+	ex	de,hl			; de->location to extract to
+	ld	hl,(.size)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.copy			; nothing needed has to be copied
+	push	hl
+	push	de
+	call	_EnoughMem		; hl=size of sections
+	pop	de
+	pop	hl
+	jp	c,_errmemory		; throw a memory error -- need more ram!
+	call	_InsertMem		; insert memory for the sections (de)
+	ld	hl,(.size)
+	ld	de,(asm_prgm_size)
+	add	hl,de
+	ld	(asm_prgm_size),hl	; store new size of program+libraries
+
+.copy:
+	ld	c,0
+.copyloop:
+	call	_isneededsection
+	jr	z,.copynext
+	call	_isreadonlysection
+	jr	nz,.inplace
+	call	_sectionslot
+	ld	de,0
+.destination := $-3
+	ld	(hl),de			; remember where the section goes
+	call	_sectionbounds		; hl=start offset, de=size
+	push	bc
+	push	de
+	ld	de,(arclocation)
+	add	hl,de			; hl->section in archive
+	pop	bc			; bc=size of section
+	ld	de,(.destination)
+	ld	a,b
+	or	a,c
+	jr	z,.copied
+	ldir				; copy in the section to ram
+	ld	(.destination),de
+.copied:
+	pop	bc
+	jr	.copynext
+.inplace:
+	call	_sectionslot
+	push	hl
+	call	_sectionbounds		; hl=start offset
+	ld	de,(arclocation)
+	add	hl,de
+	ex	de,hl			; de->section in archive
+	pop	hl
+	ld	(hl),de			; the section runs from the archive
+.copynext:
+	inc	c
+	ld	a,(sectioncount)
+	cp	a,c
+	jr	nz,.copyloop
+
+	ld	hl,(relocationtblptr)
+	ld	(.relocation),hl
+	ld	hl,(relocsections)
+	ld	(.relocationsections),hl
+.relocateloop:
+	ld	hl,0
+.relocation := $-3
+	ld	de,(endrelocationtbl)
+	call	_CpHLDE			; have we reached the end of the relocation table
+	jr	z,.resolve
+	call	_LoadDEInd_s		; de=offset in library to relocate
+	ld	(.relocation),hl
+	ld	hl,0
+.relocationsections := $-3
+	ld	c,(hl)			; c=section holding the relocation
+	inc	hl
+	ld	b,(hl)			; b=section it points to
+	inc	hl
+	ld	(.relocationsections),hl
+	push	bc
+	push	de
+	call	_isneededsection	; only relocate the sections just extracted
+	pop	de
+	pop	bc
+	jr	z,.relocateloop
+	push	bc
+	call	_sectionaddress		; hl->location in ram to relocate
+	pop	bc
+	push	hl
+	ld	de,(hl)			; de=offset we are relocating
+	ld	c,b
+	call	_sectionaddress		; hl=new address
+	ex	de,hl
+	pop	hl
+	ld	(hl),de			; resolved absolute address
+	jr	.relocateloop
+
+.resolve:
+	ld	c,0
+	call	_sectionslot
+	ld	hl,(hl)
+	ld	(ramlocation),hl	; the first section holds the dependency jump tables
+	call	_enqueuealldependencies
+	ld	hl,(jumptblptr)		; hl->start of function jump table
+.resolveloop:
+	ld	a,(hl)
+	cp	a,jp_byte		; jp byte ($C3)
+	jr	nz,.resolved
+	inc	hl			; bypass jp byte ($C3)
+	push	hl
+	ld	hl,(hl)			; offset in vector table (0,3,6, etc.)
+	ld	bc,3
+	call	__idivs			; hl=export index
+	push	hl
+	add	hl,hl
+	ld	de,(vectortblptr)
+	add	hl,de			; hl->correct vector entry
+	call	_LoadDEInd_s		; de=offset in lib for function
+	pop	hl
+	ld	bc,(exportsections)
+	add	hl,bc
+	ld	c,(hl)			; c=section of function
+	call	_sectionaddress		; hl->function in ram
+	ex	de,hl
+	pop	hl			; restore jump offset
+	ld	(hl),de			; de=resolved address
+	inc	hl
+	inc	hl
+	inc	hl			; move to next jump
+	jr	.resolveloop
+.resolved:
+	ld	(nextlibptr),hl		; hl->next library in program (if there is one)
+	jp	_donerelocateabsolutes	; sections are relocated as they are extracted
+
+_needsection:				; a=section whose closure is added to the needed sections
+	ld	bc,0
+	ld	c,a
+	ld	a,(sectionmapsize)
+	ld	b,a
+	mlt	bc
+	ld	hl,(sectionclosures)
+	add	hl,bc
+	ld	de,neededsections
+	ld	a,(sectionmapsize)
+	ld	b,a
+.loop:
+	ld	a,(de)
+	or	a,(hl)
+	ld	(de),a
+	inc	hl
+	inc	de
+	djnz	.loop
+	ret
+
+_isreadonlysection:			; c=section, nz if it is executed in place
+	ld	hl,(readonlysections)
+	jr	_issection
+
+_isneededsection:			; c=section, nz if it is in the needed sections
+	ld	hl,neededsections
+_issection:				; hl->section bitmap
+	ld	de,0
+	ld	a,c
+	srl	a
+	srl	a
+	srl	a
+	ld	e,a
+	add	hl,de
+	ld	a,c
+	and	a,7
+	ld	b,a
+	inc	b
+	ld	a,(hl)
+.shift:
+	rrca
+	djnz	.shift			; carry=bit of the section
+	sbc	a,a
+	ret
+
+_sectionbounds:				; c=section, returns hl=start offset, de=size
+	push	bc
+	ld	hl,(sectionstarts)
+	ld	de,0
+	ld	e,c
+	add	hl,de
+	add	hl,de
+	call	_LoadDEInd_s		; de=start offset
+	push	de
+	call	_LoadDEInd_s		; de=start offset of the next section
+	pop	hl
+	ex	de,hl
+	or	a,a
+	sbc	hl,de
+	ex	de,hl
+	pop	bc
+	ret
+
+_sectionslot:				; c=section, returns hl->address of section in ram
+	ld	hl,(sectionstate)
+	ld	de,stateaddresses
+	add	hl,de
+	ld	de,0
+	ld	e,c
+	add	hl,de
+	add	hl,de
+	add	hl,de
+	ret
+
+_sectionaddress:			; c=section, de=offset in library, returns hl=address in ram
+	push	de
+	call	_sectionbounds		; hl=start offset
+	pop	de
+	ex	de,hl
+	or	a,a
+	sbc	hl,de			; hl=offset in section
+	push	hl
+	call	_sectionslot
+	ld	hl,(hl)
+	pop	de
+	add	hl,de
+	ret
+
+_cacheload:				; hl->import tables of the program, runs the program if its prelinked image is valid
+	res	cacheexists,(iy+asmflag)
+	res	cachearchived,(iy+asmflag)
+	ld	(_cachekey.imports),hl
+	ld	de,(asm_prgm_size)
+	ld	(_cachekey.prgmsize),de
+	push	hl
+	call	_scanimports		; hl->start of program
+	pop	de
+	or	a,a
+	sbc	hl,de
+	ld	(_cachekey.importsize),hl
+	call	_cacheop1
+	call	_ChkFindSym
+	ret	c			; the program doesn't use a prelinked image
+	call	_chkinram
+	jr	z,.inram
+	set	cachearchived,(iy+asmflag)
+	ex	de,hl
+	ld	de,9
+	add	hl,de
+	ld	e,(hl)
+	add	hl,de
+	inc	hl
+	ex	de,hl
+.inram:
+	ex	de,hl			; hl->size bytes
+	call	_LoadDEInd_s		; de=size of image
+	ld	a,e
+	or	a,d
+	jr	z,.enable		; an empty image is rewritten after linking
+	ld	de,_cachekey
+	ld	bc,_cachekey.magicsize
+	call	_cachecompare
+	ret	nz			; not a prelinked image, leave it alone
+	set	cacheexists,(iy+asmflag)
+	ld	bc,_cachekey.size - _cachekey.magicsize
+	call	_cachecompare
+	ret	nz			; the program changed
+	ld	de,(_cachekey.imports)
+	ld	bc,(_cachekey.importsize)
+	call	_cachecompare
+	ret	nz			; the import tables changed, they are still unresolved here
+	ld	b,(hl)			; b=number of libraries
+	inc	hl
+	ld	de,(hl)
+	ld	(_cacheimagesize),de
+	inc	hl
+	inc	hl
+	inc	hl
+.library:
+	push	bc
+	push	hl
+	ld	de,OP1+1
+	ld	bc,9
+	ldir
+	ld	a,appVarObj
+	ld	(OP1),a
+	call	_ChkFindSym
+	jr	c,.invalid		; the library was deleted
+	call	_chkinram
+	jr	z,.invalid		; the library will be archived again
+	ex	de,hl
+	ld	de,9
+	add	hl,de
+	ld	e,(hl)
+	add	hl,de
+	ld	de,1+2+3
+	add	hl,de			; hl->vector table of library
+	ex	de,hl
+	pop	hl
+	ld	bc,9
+	add	hl,bc			; hl->vector table the image was linked against
+	push	hl
+	ld	hl,(hl)
+	or	a,a
+	sbc	hl,de
+	pop	hl
+	pop	bc
+	ret	nz			; the library was moved or updated
+	inc	hl
+	inc	hl
+	inc	hl
+	djnz	.library
+	push	hl
+	ld	hl,(_cacheimagesize)
+	call	_EnoughMem
+	pop	hl
+	ret	c			; let the loader report the memory error
+	ld	de,(_cachekey.imports)
+	ld	bc,(_cachekey.importsize)
+	ldir				; copy in the resolved import tables
+	ex	de,hl
+	ld	hl,(_cacheimagesize)
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.run			; all libraries are kept in the archive
+	push	de			; de->libraries in the image
+	ld	hl,usermem
+	ld	de,(asm_prgm_size)
+	add	hl,de
+	ex	de,hl			; de->end of program
+	ld	hl,(_cacheimagesize)
+	push	de
+	call	_InsertMem		; insert memory for the linked libraries (de)
+	pop	de
+	ld	hl,(asm_prgm_size)
+	ld	bc,(_cacheimagesize)
+	add	hl,bc
+	ld	(asm_prgm_size),hl	; store new size of program+libraries
+	pop	hl
+	bit	cachearchived,(iy+asmflag)
+	jr	nz,.copy
+	add	hl,bc			; an image in ram moved up with the inserted memory
+.copy:
+	ldir				; copy in the linked libraries
+.run:
+	ld	hl,(_cachekey.imports)
+	ld	de,(_cachekey.importsize)
+	add	hl,de
+	ld	(prgmstart),hl
+	res	cacheexists,(iy+asmflag)
+	ld	sp,(eSP)
+	jp	_runpgrm
+.invalid:
+	pop	hl
+	pop	bc
+	ret
+.enable:
+	set	cacheexists,(iy+asmflag)
+	ret
+
+_cachesave:				; saves the linked import tables and libraries as the prelinked image of the program
+	call	_cacheop1
+	call	_ChkFindSym
+	ret	c
+	call	_cacheprgm
+	ret	nz			; the unresolved import tables can't be stored
+	call	_cacheop1
+	call	_ChkFindSym
+	call	_DelVarArc		; remove the outdated image
+	ld	hl,(endarclibrarylocations)
+	ld	de,-arclibrarylocations
+	add	hl,de
+	ld	bc,-18
+	ld	a,-1
+.count:
+	inc	a
+	add	hl,bc
+	jr	c,.count
+	ld	(.libraries),a
+	ld	bc,0
+	ld	c,a
+	ld	b,12
+	mlt	bc			; bc=size of library names and vector table pointers
+	ld	hl,(asm_prgm_size)
+	ld	de,(_cachekey.prgmsize)
+	or	a,a
+	sbc	hl,de
+	ld	(_cacheimagesize),hl
+	add	hl,bc
+	ld	de,(_cachekey.importsize)
+	add	hl,de
+	add	hl,de
+	ld	de,_cachekey.size + 1 + 3
+	add	hl,de			; hl=size of image
+	ld	(.size),hl
+	call	_EnoughMem
+	ret	c			; the program runs fine without an image
+	call	_cacheop1
+	ld	hl,0
+.size := $-3
+	call	_CreateAppVar
+	inc	de
+	inc	de			; de->data of image
+	ld	hl,_cachekey
+	ld	bc,_cachekey.size
+	ldir
+	push	de
+	call	_cacheprgm		; the program variable may have moved
+	pop	de
+	ld	bc,(_cachekey.importsize)
+	ldir				; unresolved import tables
+	ld	a,0
+.libraries := $-1
+	ld	(de),a
+	inc	de
+	ld	hl,_cacheimagesize
+	ld	bc,3
+	ldir
+	ld	hl,arclibrarylocations
+	ld	b,a
+.library:
+	push	bc
+	ld	bc,12
+	ldir				; library name and vector table pointer
+	ld	bc,18-12
+	add	hl,bc
+	pop	bc
+	djnz	.library
+	ld	hl,(_cachekey.imports)
+	ld	bc,(_cachekey.importsize)
+	ldir				; resolved import tables
+	ld	hl,(_cacheimagesize)
+	push	hl
+	pop	bc
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.archive
+	push	de
+	ld	hl,usermem
+	ld	de,(_cachekey.prgmsize)
+	add	hl,de			; hl->linked libraries
+	pop	de
+	ldir
+.archive:
+	bit	cachearchived,(iy+asmflag)
+	ret	z
+	ld	hl,(.size)
+	ld	bc,12
+	add	hl,bc
+	call	_FindFreeArcSpot
+	ret	z			; don't garbage collect while launching
+	call	_cacheop1
+	call	_ChkFindSym
+	jp	_Arc_Unarc
+
+_cacheop1:				; op1=name of the prelinked image of the program
+	call	_PopOP1
+	call	_PushOP1
+	ld	a,appVarObj
+	ld	(OP1),a
+	ld	a,(OP1+1)
+	cp	a,'A'
+	ret	c
+	cp	a,'Z'+1
+	ret	nc
+	add	a,'a'-'A'
+	ld	(OP1+1),a
+	ret
+
+_cacheprgm:				; returns hl->unresolved import tables in the program variable, nz if not found
+	call	_PopOP1
+	call	_PushOP1		; op1=name of the program
+	call	_ChkFindSym
+	jr	c,.none
+	call	_chkinram
+	jr	z,.inram
+	ex	de,hl
+	ld	de,9
+	add	hl,de
+	ld	e,(hl)
+	add	hl,de
+	inc	hl
+	ex	de,hl
+.inram:
+	ex	de,hl			; hl->size bytes
+	call	_LoadDEInd_s		; de=size of program
+	push	hl
+	ld	hl,(_cachekey.prgmsize)
+	or	a,a
+	sbc	hl,de
+	pop	hl
+	ret	nz			; not what is running, e.g. a compressed program
+	ld	de,(_cachekey.imports)
+	add	hl,de
+	ld	de,-usermem
+	add	hl,de
+	cp	a,a
+	ret
+.none:
+	xor	a,a
+	inc	a
+	ret
+
+_cachecompare:				; compares bc bytes at hl and de, z if they match
+	ld	a,(de)
+	inc	de
+	cpi
+	ret	nz
+	jp	pe,_cachecompare
+	ret
+
+_scanimports:				; hl->import tables, returns hl->first byte after them
+	ld	a,(hl)
+	cp	a,lib_byte
+	ret	nz
+	call	_movetostrngend
+	inc	hl			; bypass version byte
+.jump:
+	ld	a,(hl)
+	cp	a,jp_byte
+	jr	nz,_scanimports
+	inc	hl
+	inc	hl
+	inc	hl
+	inc	hl
+	jr	.jump
+
+_cachekey:				; identifies the program and load address an image was linked for
+	db	'LLC',2
+.prgmsize:
+	dl	0
+.imports:
+	dl	0
+.importsize:
+	dl	0
+.size := $ - _cachekey
+.magicsize := 3				; images of other versions are rebuilt
+_cacheimagesize:
+	dl	0
+
 _versionerror:
 	ld	hl,_versionlibstr
 	jr	_throwerror
@@ -7,11 +7,22 @@ BSSHEAP_HIGH        ?= D13FD6
 STACK_HIGH          ?= D1A87E
 INIT_LOC            ?= D1A87F
 USE_FLASH_FUNCTIONS ?= YES
+PRINTF_FLOAT        ?= YES
 OUTPUT_MAP          ?= YES
 ARCHIVED            ?= NO
 OPT_MODE            ?= -optsize
 EXTRA_CFLAGS        ?=
 EXTRA_CXXFLAGS      ?=
+FASTCODE            ?=
+FASTCODE_PROFILE    ?=
+FASTCODE_LOC        ?= E30900
+FASTCODE_END        ?= E30C00
+FASTCODE_SIZE       ?= 300
+OVERLAYS            ?=
+PROFILE             ?= NO
+PROFILE_RATE        ?= 512
+INSTRUMENT          ?= NO
+INSTRUMENT_EVENTS   ?= 1024
 #----------------------------
 SRCDIR              ?= src
 OBJDIR              ?= obj
@@ -94,6 +105,10 @@ MKDIR_NATIVE = $(call MKDIR,$(call QUOTE_ARG,$(call NATIVEPATH,$1)))
 
 FASMG_FILES = $(subst $(space),$(comma) ,$(patsubst %,"%",$(subst ",\",$(subst \,\\,$(call NATIVEPATH,$1)))))#"
 LINKER_SCRIPT ?= $(CEDEV)/include/.linker_script
+FASTCODE_SCRIPT ?= $(CEDEV)/include/.fastcode
+DECOMPRESS_SCRIPT ?= $(CEDEV)/include/fasmg-ez80/decompress.fasmg
+OVERLAY_SCRIPT ?= $(CEDEV)/include/.overlay
+INSTRUMENT_SCRIPT ?= $(CEDEV)/include/.instrument
 
 # ensure native paths
 SRCDIR := $(call NATIVEPATH,$(SRCDIR))
@@ -143,18 +158,97 @@ endif
 ifeq ($(ARCHIVED),YES)
 CONVBINFLAGS += --archive
 endif
+CONVBINFLAGS += --oformat 8xp
+CONVBINFLAGS += --name $(TARGET)
+
+# compressed programs are wrapped in a launcher that decompresses them in place
 ifeq ($(COMPRESSED),YES)
-CONVBINFLAGS += --oformat 8xp-auto-decompress
+PROGRAMBIN    := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).launcher.bin)
 else
-CONVBINFLAGS += --oformat 8xp
+PROGRAMBIN    := $(call NATIVEPATH,$(BINDIR)/$(TARGETBIN))
 endif
-CONVBINFLAGS += --name $(TARGET)
+PROGRAMDATA   := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).data.bin)
+PROGRAMZX7    := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).zx7)
 
 # link cleanup source
 ifeq ($(CLEANUP),YES)
 LINK_CLEANUP = , $(call FASMG_FILES,$(F_CLEANUP)) used
 endif
 
+# record the entries and exits of the functions of the c sources, along with
+# the cpu cycles counted by timer 3, in a ring buffer of the last
+# INSTRUMENT_EVENTS ones. it is stored in the TRACE appvar on exit, which
+# tools/profile/callgraph.sh turns into a call graph with the map file.
+# sampling needs timer 3 as well, so PROFILE is ignored
+ifeq ($(INSTRUMENT),YES)
+INSTRUMENT_FLAG := 1
+override PROFILE := NO
+INSTRUMENT_MOVE = && $(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(INSTRUMENT_SCRIPT))) \
+	-i $(call QUOTE_ARG,source equ '$(call NATIVEPATH,$@)') $(call QUOTE_ARG,$@.tmp) $(NOSTDOUT) && \
+	$(MV) $(call QUOTE_ARG,$@.tmp) $(call QUOTE_ARG,$@)
+else
+INSTRUMENT_FLAG := 0
+endif
+
+# sample the program counter PROFILE_RATE times a second from a timer 3
+# interrupt, and store the histogram in the PROFILE appvar on exit. the map
+# file is needed to turn it into a profile with tools/profile/profile.sh.
+# the os interrupts are masked while the program runs. functions stay out of
+# the fastcode section, as int_Initialize clears the cursor ram at startup and
+# the histogram only covers the program
+ifeq ($(PROFILE),YES)
+PROFILE_FLAG := 1
+override FASTCODE :=
+override FASTCODE_PROFILE :=
+else
+PROFILE_FLAG := 0
+endif
+
+# move functions into the fastcode section, which is copied into the lcd cursor
+# ram at startup. FASTCODE lists the functions, and FASTCODE_PROFILE names a
+# profile with lines of "_function samples size" to fill FASTCODE_SIZE from.
+# linking fails if the section runs past FASTCODE_END, the end of the cursor
+# ram. at the default location it overlaps graphx cursor images 1 to 3 and
+# 64x64 images, and the interrupt vector table of int_Initialize, so those
+# can't be used together with it. graphx fills only borrow the ram before it
+ifneq ("$(FASTCODE)$(FASTCODE_PROFILE)","")
+FASTCODE_FLAGS = -i $(call QUOTE_ARG,source equ '$(call NATIVEPATH,$@)') -i $(call QUOTE_ARG,budget = $$$(FASTCODE_SIZE))
+ifneq ("$(FASTCODE)","")
+FASTCODE_FLAGS += -i $(call QUOTE_ARG,functions equ $(subst $(space),$(comma),$(patsubst %,'_%',$(FASTCODE))))
+endif
+ifneq ("$(FASTCODE_PROFILE)","")
+FASTCODE_FLAGS += -i $(call QUOTE_ARG,profile equ '$(call NATIVEPATH,$(FASTCODE_PROFILE))')
+endif
+FASTCODE_MOVE = && $(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(FASTCODE_SCRIPT))) $(FASTCODE_FLAGS) $(call QUOTE_ARG,$@.tmp) $(NOSTDOUT) && \
+	$(MV) $(call QUOTE_ARG,$@.tmp) $(call QUOTE_ARG,$@)
+endif
+
+# move the functions listed in OVERLAY_<group> for each group of OVERLAYS into
+# an appvar named after the group, loaded by the overlay manager when called.
+# the groups are linked twice at different bases outside of ram, and the
+# addresses to relocate are found by comparing both links
+ifneq ("$(OVERLAYS)","")
+OVERLAY_SRC    := $(call NATIVEPATH,$(OBJDIR)/overlays.src)
+OVERLAY_LINK   := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).link.bin)
+OVERLAY_SHIFT  := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).shift.bin)
+OVERLAY_SPLIT  := $(call NATIVEPATH,$(OBJDIR)/$(TARGET).bin)
+OVERLAY_GROUPS := $(subst $(space),$(comma),$(patsubst %,'%',$(OVERLAYS)))
+OVERLAY_PAIRS  := $(join $(OVERLAYS),$(addprefix :,$(wordlist 1,$(words $(OVERLAYS)),0 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15)))
+OVERLAY_OFFSET := 0
+OVERLAY_GROUP_FLAGS = \
+	-i $(call QUOTE_ARG,locate ovl_$1 at $$400000 + $2 * $$20000 + $(OVERLAY_OFFSET)) \
+	-i $(call QUOTE_ARG,symbol __ovlbase_$1 = ovl_$1.base) \
+	-i $(call QUOTE_ARG,symbol __ovllen_$1 = ovl_$1.length)
+OVERLAY_FLAGS = \
+	$(foreach pair,$(OVERLAY_PAIRS),$(call OVERLAY_GROUP_FLAGS,$(word 1,$(subst :, ,$(pair))),$(word 2,$(subst :, ,$(pair))))) \
+	-i $(call QUOTE_ARG,order $(subst $(space),$(comma) ,$(addprefix ovl_,$(OVERLAYS))))
+OVERLAY_MOVE = $(foreach group,$(OVERLAYS),&& $(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(FASTCODE_SCRIPT))) \
+	-i $(call QUOTE_ARG,source equ '$(call NATIVEPATH,$@)') -i $(call QUOTE_ARG,overlay equ '$(group)') \
+	-i $(call QUOTE_ARG,functions equ $(subst $(space),$(comma),$(patsubst %,'_%',$(OVERLAY_$(group))))) \
+	$(call QUOTE_ARG,$@.tmp) $(NOSTDOUT) && $(MV) $(call QUOTE_ARG,$@.tmp) $(call QUOTE_ARG,$@))
+LINK_FILES += $(OVERLAY_SRC)
+endif
+
 # output debug map file
 ifeq ($(OUTPUT_MAP),YES)
 LDMAPFLAG = -i map
@@ -167,6 +261,15 @@ else
 STATIC := 1
 endif
 
+# link the float conversions of printf style functions. without them, %f, %e
+# and %g print a ? instead. the linker keeps only the runtime sources a program
+# references, which tools/link/kept.sh lists along with the reference to each
+ifeq ($(PRINTF_FLOAT),YES)
+FLOAT_FORMAT := 1
+else
+FLOAT_FORMAT := 0
+endif
+
 ifneq ("$(EXTRA_CFLAGS)","")
 EXTRA_COMPILER_FLAGS := $(addprefix -define:,$(EXTRA_CFLAGS))
 endif
@@ -186,7 +289,15 @@ LDFLAGS ?= \
 	-i $(call QUOTE_ARG,range bss $$$(BSSHEAP_LOW) : $$$(BSSHEAP_HIGH)) \
 	-i $(call QUOTE_ARG,symbol __stack = $$$(STACK_HIGH)) \
 	-i $(call QUOTE_ARG,locate header at $$$(INIT_LOC)) \
+	-i $(call QUOTE_ARG,locate fastcode at $$$(FASTCODE_LOC)) \
+	-i $(call QUOTE_ARG,FASTCODE_END := $$$(FASTCODE_END)) \
 	-i $(call QUOTE_ARG,STATIC := $(STATIC)) \
+	-i $(call QUOTE_ARG,PRINTF_FLOAT := $(FLOAT_FORMAT)) \
+	-i $(call QUOTE_ARG,PROFILE := $(PROFILE_FLAG)) \
+	-i $(call QUOTE_ARG,PROFILE_RATE := $(PROFILE_RATE)) \
+	-i $(call QUOTE_ARG,INSTRUMENT := $(INSTRUMENT_FLAG)) \
+	-i $(call QUOTE_ARG,INSTRUMENT_EVENTS := $(INSTRUMENT_EVENTS)) \
+	$(OVERLAY_FLAGS) \
 	-i $(call QUOTE_ARG,srcs $(call FASMG_FILES,$(F_LAUNCHER)) used if libs.length$(LINK_ICON)$(LINK_CLEANUP)$(comma) $(call FASMG_FILES,$(F_STARTUP)) used$(comma) $(call FASMG_FILES,$(LINK_FILES))) \
 	-i $(call QUOTE_ARG,libs $(call FASMG_FILES,$(LINK_LIBLOAD)) used if libs.length$(comma) $(call FASMG_FILES,$(LINK_LIBS)))
 
@@ -199,14 +310,42 @@ debug: DEBUGMODE = DEBUG
 debug: CCDEBUGFLAG = -debug
 debug: $(BINDIR)/$(TARGET8XP) ;
 
-$(BINDIR)/$(TARGET8XP): $(BINDIR)/$(TARGETBIN)
+$(BINDIR)/$(TARGET8XP): $(PROGRAMBIN)
 	$(Q)$(call MKDIR_NATIVE,$(@D))
 	$(Q)$(CONVBIN) $(CONVBINFLAGS) --input $(call QUOTE_ARG,$(call NATIVEPATH,$<)) --output $(call QUOTE_ARG,$(call NATIVEPATH,$@))
 
+$(OBJDIR)/$(TARGET).launcher.bin: $(BINDIR)/$(TARGETBIN)
+	$(Q)$(call MKDIR_NATIVE,$(@D))
+	$(Q)echo "[compressing] $<"
+	$(Q)$(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(DECOMPRESS_SCRIPT))) -i $(call QUOTE_ARG,program equ '$(call NATIVEPATH,$<)') $(call QUOTE_ARG,$(PROGRAMDATA)) $(NOSTDOUT)
+	$(Q)$(CONVBIN) --iformat bin --oformat bin --compress zx7 --input $(call QUOTE_ARG,$(PROGRAMDATA)) --output $(call QUOTE_ARG,$(PROGRAMZX7)) $(NOSTDOUT)
+	$(Q)$(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(DECOMPRESS_SCRIPT))) -i $(call QUOTE_ARG,program equ '$(call NATIVEPATH,$<)') -i $(call QUOTE_ARG,payload equ '$(PROGRAMZX7)') $(call QUOTE_ARG,$(call NATIVEPATH,$@)) $(NOSTDOUT)
+
+ifneq ("$(OVERLAYS)","")
+$(BINDIR)/$(TARGETBIN): $(OVERLAY_LINK) $(OVERLAY_SHIFT)
+	$(Q)$(call MKDIR_NATIVE,$(@D))
+	$(Q)echo "[overlays] $(OVERLAYS)"
+	$(Q)$(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(OVERLAY_SCRIPT))) -i $(call QUOTE_ARG,groups equ $(OVERLAY_GROUPS)) \
+	-i $(call QUOTE_ARG,program equ '$(OVERLAY_LINK)') -i $(call QUOTE_ARG,relocated equ '$(OVERLAY_SHIFT)') $(call QUOTE_ARG,$(OVERLAY_SPLIT)) $(NOSTDOUT)
+	$(Q)$(MV) $(call QUOTE_ARG,$(OVERLAY_SPLIT)) $(call QUOTE_ARG,$(call NATIVEPATH,$@))
+	$(Q)$(foreach group,$(OVERLAYS),$(CONVBIN) --iformat bin --oformat 8xv --archive --name $(group) \
+	--input $(call QUOTE_ARG,$(call NATIVEPATH,$(OBJDIR)/$(TARGET).$(group))) --output $(call QUOTE_ARG,$(call NATIVEPATH,$(BINDIR)/$(group).8xv)) &&) echo
+
+$(OVERLAY_SHIFT): OVERLAY_OFFSET := $$10000
+$(OVERLAY_LINK) $(OVERLAY_SHIFT): $(LINK_FILES) $(ICONSRC)
+	$(Q)$(call MKDIR_NATIVE,$(@D))
+	$(Q)echo "[linking] $@"
+	$(Q)$(LD) $(LDFLAGS) $(call NATIVEPATH,$@) $(NOSTDOUT)
+
+$(OVERLAY_SRC): $(MAKEFILE_LIST)
+	$(Q)$(call MKDIR_NATIVE,$(@D))
+	$(Q)$(LD) $(call QUOTE_ARG,$(call NATIVEPATH,$(OVERLAY_SCRIPT))) -i $(call QUOTE_ARG,groups equ $(OVERLAY_GROUPS)) $(call QUOTE_ARG,$@) $(NOSTDOUT)
+else
 $(BINDIR)/$(TARGETBIN): $(LINK_FILES) $(ICONSRC)
 	$(Q)$(call MKDIR_NATIVE,$(@D))
 	$(Q)echo "[linking] $@"
 	$(Q)$(LD) $(LDFLAGS) $(call NATIVEPATH,$@) $(NOSTDOUT)
+endif
 
 # this rule handles conversion of the icon, if it is ever updated
 $(ICONSRC): $(ICONIMG)
@@ -214,11 +353,11 @@ $(ICONSRC): $(ICONIMG)
 	$(Q)$(ICON_CONV)
 
 # these rules compile the source files into object files
-$(OBJDIR)/%.src: $(SRCDIR)/%.c $(USERHEADERS)
+$(OBJDIR)/%.src: $(SRCDIR)/%.c $(USERHEADERS) $(FASTCODE_PROFILE)
 	$(Q)$(call MKDIR_NATIVE,$(@D))
 	$(Q)echo "[compiling C]   $<"
 	$(Q)$(CC) $(CFLAGS) $(call QUOTE_ARG,$(call WINPATH,$(addprefix $(MAKEDIR)/,$<))) && \
-	$(MV) $(call QUOTE_ARG,$(call TO_LOWER,$(@F))) $(call QUOTE_ARG,$@)
+	$(MV) $(call QUOTE_ARG,$(call TO_LOWER,$(@F))) $(call QUOTE_ARG,$@) $(INSTRUMENT_MOVE) $(FASTCODE_MOVE) $(OVERLAY_MOVE)
 
 $(OBJDIR)/%.cpp.src: $(SRCDIR)/%.cpp $(USERHEADERS)
 	$(Q)$(call MKDIR,$(@D))
@@ -1,19 +1,555 @@
 ;-------------------------------------------------------------------------------
 include '../include/library.inc'
+include '../include/include_library.inc'
 ;-------------------------------------------------------------------------------
 
 library 'SRLDRVCE', 0
 
 ;-------------------------------------------------------------------------------
-; no dependencies
+; dependencies
 ;-------------------------------------------------------------------------------
+include_library '../usbdrvce/usbdrvce.asm'
 
 ;-------------------------------------------------------------------------------
 ; v0 functions (not final, subject to change!)
 ;-------------------------------------------------------------------------------
 	export srl_Init
+	export srl_SetRate
+	export srl_Read
+	export srl_Write
+	export srl_GetCDCStandardDescriptors
 ;-------------------------------------------------------------------------------
 
+;-------------------------------------------------------------------------------
+; memory structures
+;-------------------------------------------------------------------------------
+struc ring			; ring buffer, empty when read = write
+	label .: 12
+	.buf		rl 1	; start of buffer
+	.end		rl 1	; end of buffer
+	.read		rl 1	; next byte to read
+	.write		rl 1	; next byte to write
+	assert $-. = 12
+end struc
+struc serial			; serial device structure
+	label .: 46
+	.dev		rl 1	; usb device
+	.rxEndpoint	rl 1	; bulk endpoint data is received on
+	.txEndpoint	rl 1	; bulk endpoint data is sent on
+	.rxPacket	rl 1	; receive max packet size
+	.status		rb 1	; nonzero once a transfer failed
+	.rxBusy		rb 1	; nonzero while a receive transfer is scheduled
+	.txBusy		rb 1	; nonzero while a send transfer is scheduled
+	.rx		ring	; receive ring buffer
+	.tx		ring	; transmit ring buffer
+	.lineCoding	rb 7	; cdc line coding
+	assert $-. = 46
+end struc
+iterate type, ring, serial
+ iterate <base,name>, 0,, iy,y
+  virtual at base
+	name#type type
+  end virtual
+ end iterate
+end iterate
+;-------------------------------------------------------------------------------
+
+;-------------------------------------------------------------------------------
+; constants
+;-------------------------------------------------------------------------------
+SRL_INTERFACE_DEVICE		:= $FE
+SRL_DEFAULT_RATE		:= 9600
+
+USB_SUCCESS			:= 0
+USB_ERROR_INVALID_PARAM		:= 3
+USB_ERROR_NO_DEVICE		:= 5
+USB_ERROR_NOT_SUPPORTED		:= 7
+;-------------------------------------------------------------------------------
+
+;-------------------------------------------------------------------------------
 srl_Init:
+; Input:
+;  ix+6 = srl device structure
+;  ix+9 = usb device
+;  ix+12 = buffer
+;  ix+15 = buffer size
+;  ix+18 = SRL_INTERFACE_DEVICE
+; Output:
+;  hl = error status
+	call	__frameset0
+	ld	iy,(ix + 6)
+	ld	hl,(ix + 9)
+	ld	(yserial.dev),hl
+	xor	a,a
+	ld	(yserial.status),a
+	ld	(yserial.rxBusy),a
+	ld	(yserial.txBusy),a
+	ld	a,(ix + 18)
+	cp	a,SRL_INTERFACE_DEVICE
+	jq	nz,.unsupported			; usbdrvce has no host role yet
+	ld	bc,($81 shl 8) or $02		; endpoints of srl_GetCDCStandardDescriptors
+	push	bc
+	ld	a,c
+	call	_Endpoint
+	ld	(yserial.rxEndpoint),hl		; the host sends on bulk out
+	pop	bc
+	jq	z,.unconfigured
+	ld	a,b
+	call	_Endpoint
+	ld	(yserial.txEndpoint),hl		; and receives on bulk in
+	jq	z,.unconfigured
+	push	iy
+	ld	hl,(yserial.rxEndpoint)
+	push	hl
+	call	usb_GetEndpointMaxPacketSize
+	pop	bc
+	pop	iy
+	ld	(yserial.rxPacket),hl
+	ld	(yserial.rxPacket + 2),0
+	ld	hl,(ix + 15)
+	ld	c,1
+	call	__ishru				; each ring gets half of the buffer
+	ld	de,(yserial.rxPacket)
+	push	hl
+	scf
+	sbc	hl,de
+	pop	hl
+	jq	c,.invalid			; no room for a full packet
+	ld	de,(ix + 12)
+	ld	(yserial.rx.buf),de
+	ld	(yserial.rx.read),de
+	ld	(yserial.rx.write),de
+	add	hl,de
+	ld	(yserial.rx.end),hl
+	ld	(yserial.tx.buf),hl
+	ld	(yserial.tx.read),hl
+	ld	(yserial.tx.write),hl
+	ld	hl,(ix + 12)
+	ld	de,(ix + 15)
+	add	hl,de
+	ld	(yserial.tx.end),hl
+	ld	hl,SRL_DEFAULT_RATE
+	call	_SetRate
+	call	_RxSchedule
+.return:
+	ld	sp,ix
+	pop	ix
+	ret
+.unconfigured:
+	ld	hl,USB_ERROR_NO_DEVICE
+	jq	.return
+.unsupported:
+	ld	hl,USB_ERROR_NOT_SUPPORTED
+	jq	.return
+.invalid:
+	ld	hl,USB_ERROR_INVALID_PARAM
+	jq	.return
+
+;-------------------------------------------------------------------------------
+srl_SetRate:
+; Input:
+;  sp+3 = srl device structure
+;  sp+6 = baud rate
+; Output:
+;  hl = error status
+	pop	de,iy
+	ex	(sp),hl
+	push	hl,de
+_SetRate:
+	ld	(yserial.lineCoding),hl		; dwDTERate
+	xor	a,a
+	ld	(yserial.lineCoding + 3),a
+	ld	(yserial.lineCoding + 4),a	; one stop bit
+	ld	(yserial.lineCoding + 5),a	; no parity
+	ld	(yserial.lineCoding + 6),8	; eight data bits
+	sbc	hl,hl				; the host picks the rate in device role
+	ret
+
+;-------------------------------------------------------------------------------
+srl_Read:
+; Input:
+;  ix+6 = srl device structure
+;  ix+9 = destination
+;  ix+12 = max number of bytes
+; Output:
+;  hl = number of bytes read, or -1 if the device failed
+	call	__frameset0
+	ld	hl,(ix + 12)
+	push	hl
+	ld	iy,(ix + 6)
+.copy:
+	lea	iy,yserial.rx
+	call	_RingUsed
+	push	bc
+	call	_Take
+	pop	hl
+	jq	z,.done
+	ld	de,(ix + 9)
+	ldir
+	ld	(ix + 9),de
+	call	_RingWrap
+	ld	(yring.read),hl
+	ld	iy,(ix + 6)
+	jq	.copy
+.done:
+	ld	iy,(ix + 6)
+	call	_RxSchedule			; restart if the ring was full
+;	jq	_Count
+
+;-------------------------------------------------------------------------------
+_Count:
+; Input:
+;  iy = srl device structure
+;  ix-3 = requested number of bytes
+;  ix+12 = bytes left over
+; Output:
+;  hl = number of bytes handled, or -1 if none and the device failed
+	ld	hl,(ix - 3)
+	ld	de,(ix + 12)
+	or	a,a
+	sbc	hl,de
+	jq	nz,.return
+	ld	a,(yserial.status)
+	or	a,a
+	jq	z,.return
+	scf
+	sbc	hl,hl
+.return:
+	ld	sp,ix
+	pop	ix
 	ret
 
+;-------------------------------------------------------------------------------
+srl_Write:
+; Input:
+;  ix+6 = srl device structure
+;  ix+9 = source
+;  ix+12 = max number of bytes
+; Output:
+;  hl = number of bytes queued, or -1 if the device failed
+	call	__frameset0
+	ld	hl,(ix + 12)
+	push	hl
+	ld	iy,(ix + 6)
+	ld	a,(yserial.status)
+	or	a,a
+	jq	nz,.done
+.copy:
+	lea	iy,yserial.tx
+	call	_RingFree
+	push	bc
+	call	_Take
+	pop	de
+	jq	z,.done
+	ld	hl,(ix + 9)
+	ldir
+	ld	(ix + 9),hl
+	ex	de,hl
+	call	_RingWrap
+	ld	(yring.write),hl
+	ld	iy,(ix + 6)
+	jq	.copy
+.done:
+	ld	iy,(ix + 6)
+	call	_TxSchedule
+	jq	_Count
+
+;-------------------------------------------------------------------------------
+srl_GetCDCStandardDescriptors:
+; Output:
+;  hl -> cdc acm standard descriptors for device role
+	ld	hl,_CdcStandardDescriptors
+	ret
+
+;-------------------------------------------------------------------------------
+; internal functions
+;-------------------------------------------------------------------------------
+
+_Endpoint:
+; Input:
+;  iy = srl device structure
+;  a = endpoint address
+; Output:
+;  hl = endpoint
+;  zf = endpoint not found
+	push	iy
+	ld	de,0
+	ld	e,a
+	push	de
+	ld	hl,(yserial.dev)
+	push	hl
+	call	usb_GetDeviceEndpoint
+	pop	bc,bc
+	pop	iy
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	ret
+
+_Take:
+; Input:
+;  hl = bytes available
+;  ix+12 = bytes left to copy
+; Output:
+;  bc = bytes to copy now
+;  zf = nothing to copy
+;  ix+12 = bytes left after this copy
+	ld	bc,(ix + 12)
+	or	a,a
+	sbc	hl,bc
+	jq	nc,.take
+	add	hl,bc
+	push	hl
+	pop	bc
+.take:
+	ld	hl,(ix + 12)
+	or	a,a
+	sbc	hl,bc
+	ld	(ix + 12),hl
+	sbc	hl,hl
+	adc	hl,bc
+	ret
+
+_RingUsed:
+; Input:
+;  iy = ring
+; Output:
+;  hl = bytes that can be read before wrapping
+;  bc = read pointer
+	ld	bc,(yring.read)
+	ld	hl,(yring.write)
+	or	a,a
+	sbc	hl,bc
+	ret	nc
+	ld	hl,(yring.end)
+	or	a,a
+	sbc	hl,bc
+	ret
+
+_RingFree:
+; Input:
+;  iy = ring
+; Output:
+;  hl = bytes that can be written before wrapping
+;  bc = write pointer
+	ld	bc,(yring.write)
+	ld	hl,(yring.read)
+	scf
+	sbc	hl,bc
+	ret	nc				; keep one byte free before read
+	ld	hl,(yring.end)
+	or	a,a
+	sbc	hl,bc
+	push	hl
+	ld	hl,(yring.read)
+	ld	de,(yring.buf)
+	or	a,a
+	sbc	hl,de
+	pop	hl
+	ret	nz
+	dec	hl				; keep the last byte free
+	ret
+
+_RingWrap:
+; Input:
+;  iy = ring
+;  hl = pointer advanced past the data
+; Output:
+;  hl = pointer wrapped to the start of the buffer at the end
+	ld	de,(yring.end)
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	ret	nz
+	ld	hl,(yring.buf)
+	ret
+
+_RxSchedule:
+; Input:
+;  iy = srl device structure
+; Output:
+;  hl = error status
+;  a receive transfer is scheduled into the free space, if a packet fits
+	ld	a,(yserial.status)
+	or	a,(yserial.rxBusy)
+	ld	hl,USB_SUCCESS
+	ret	nz
+	ld	hl,(yserial.rx.read)
+	ld	de,(yserial.rx.write)
+	sbc	hl,de
+	jq	nz,.notEmpty
+	ld	hl,(yserial.rx.buf)		; rewind an empty ring
+	ld	(yserial.rx.read),hl
+	ld	(yserial.rx.write),hl
+.notEmpty:
+	lea	iy,yserial.rx
+	call	_RingFree
+	lea	iy,iy - serial.rx
+	ld	de,(yserial.rxPacket)
+	dec	de
+	ld	a,e
+	cpl
+	and	a,l
+	ld	l,a
+	ld	a,d
+	cpl
+	and	a,h
+	ld	h,a				; whole packets only
+	or	a,l
+	ret	z				; wait for srl_Read to make room
+	ld	de,_RxComplete
+	push	iy
+	push	iy,de,hl,bc
+	ld	hl,(yserial.rxEndpoint)
+	call	_Schedule
+	ret	nz
+	ld	(yserial.rxBusy),1
+	ret
+
+_TxSchedule:
+; Input:
+;  iy = srl device structure
+; Output:
+;  hl = error status
+;  a send transfer is scheduled for the queued data, if there is any
+	ld	a,(yserial.status)
+	or	a,(yserial.txBusy)
+	ld	hl,USB_SUCCESS
+	ret	nz
+	lea	iy,yserial.tx
+	call	_RingUsed
+	lea	iy,iy - serial.tx
+	ld	a,h
+	or	a,l
+	ret	z
+	ld	de,_TxComplete
+	push	iy
+	push	iy,de,hl,bc
+	ld	hl,(yserial.txEndpoint)
+	call	_Schedule
+	ret	nz
+	ld	(yserial.txBusy),1
+	ret
+
+_Schedule:
+; Input:
+;  sp+3 = buffer, length, callback, srl device structure, saved iy
+;  hl = endpoint
+; Output:
+;  hl = error status
+;  zf = scheduled
+;  iy = srl device structure
+;  arguments popped
+	pop	de
+	ld	(.return),de
+	push	hl
+	call	usb_ScheduleTransfer
+	pop	bc,bc,bc,bc,bc
+	pop	iy
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	jr	z,.scheduled
+	ld	(yserial.status),l		; stop the port
+.scheduled:
+	jp	0
+.return := $-3
+
+_RxComplete:
+; Input:
+;  sp+3 = endpoint
+;  sp+6 = transfer status
+;  sp+9 = bytes transferred
+;  sp+12 = srl device structure
+; Output:
+;  hl = USB_SUCCESS
+	ld	iy,0
+	add	iy,sp
+	ld	a,(iy + 6)
+	ld	hl,(iy + 9)
+	ld	iy,(iy + 12)
+	ld	(yserial.rxBusy),0
+	or	a,a
+	jq	nz,_Failed
+	ld	de,(yserial.rx.write)
+	add	hl,de
+	lea	iy,yserial.rx
+	call	_RingWrap
+	ld	(yring.write),hl
+	lea	iy,iy - serial.rx
+	call	_RxSchedule			; keep the pipe busy
+	jq	_Success
+
+_TxComplete:
+; Input:
+;  sp+3 = endpoint
+;  sp+6 = transfer status
+;  sp+9 = bytes transferred
+;  sp+12 = srl device structure
+; Output:
+;  hl = USB_SUCCESS
+	ld	iy,0
+	add	iy,sp
+	ld	a,(iy + 6)
+	ld	hl,(iy + 9)
+	ld	iy,(iy + 12)
+	ld	(yserial.txBusy),0
+	or	a,a
+	jq	nz,_Failed
+	ld	de,(yserial.tx.read)
+	add	hl,de
+	lea	iy,yserial.tx
+	call	_RingWrap
+	ld	(yring.read),hl
+	lea	iy,iy - serial.tx
+	call	_TxSchedule			; send whatever was queued meanwhile
+_Success:
+	ld	hl,USB_SUCCESS
+	ret
+
+_Failed:
+	ld	(yserial.status),a
+	jq	_Success
+
+;-------------------------------------------------------------------------------
+; cdc acm descriptors for device role
+;-------------------------------------------------------------------------------
+_CdcStandardDescriptors:
+	dl	.device, .configurations, .langids
+	db	2
+	dl	.strings
+.device:
+	db	18, 1			; device descriptor
+	dw	$0200			; usb 2.0
+	db	2, 0, 0, 64		; communications class
+	dw	$0451, $E008, $0220	; vendor, product, release
+	db	1, 2, 0, 1
+.configurations:
+	dl	.configuration
+.configuration:
+	db	9, 2			; configuration descriptor
+	dw	.configuration.size
+	db	2, 1, 0, $80, 50	; two interfaces, bus powered, 100mA
+	db	9, 4			; communications interface
+	db	0, 0, 1, 2, 2, 1, 0	; acm, at commands
+	db	5, $24, 0		; header functional descriptor
+	dw	$0110			; cdc 1.1
+	db	5, $24, 1, 0, 1		; call management, data interface 1
+	db	4, $24, 2, 2		; acm, supports line coding
+	db	5, $24, 6, 0, 1		; union of interfaces 0 and 1
+	db	7, 5, $83, 3		; notification endpoint
+	dw	8
+	db	255
+	db	9, 4			; data interface
+	db	1, 0, 2, $0A, 0, 0, 0
+	db	7, 5, $81, 2		; bulk in endpoint
+	dw	64
+	db	0
+	db	7, 5, $02, 2		; bulk out endpoint
+	dw	64
+	db	0
+.configuration.size := $ - .configuration
+.langids dw $0304, $0409
+.strings dl .string1, .string2
+.string1 dw $033E, 'T','e','x','a','s',' ','I','n','s','t','r','u','m','e','n','t','s',' ','I','n','c','o','r','p','o','r','a','t','e','d'
+.string2 dw $031C, 'T','I','-','8','4',' ','P','l','u','s',' ','C','E'
@@ -1,7 +1,7 @@
 /**
  * @file
  * @author
- * @brief USB Serial Host Driver
+ * @brief USB Serial Driver
  */
 
 #ifndef H_SRLDRVCE
@@ -9,12 +9,85 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <usbdrvce.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Uses the calculator itself as the serial device, with the descriptors from
+ * srl_GetCDCStandardDescriptors() given to usb_Init().
+ *
+ * Host role, talking to a serial device plugged into the calculator, is
+ * deferred until usbdrvce can schedule transfers as host, so this is the only
+ * supported interface.
+ */
+#define SRL_INTERFACE_DEVICE 0xFE
+
+/** Serial device state, treat as opaque. */
+typedef struct srl_device {
+  uint8_t data[46]; /**< Internal state. */
+} srl_device_t;
+
+/**
+ * Starts acting as a CDC ACM serial device.
+ *
+ * \p buffer is split into a receive and a transmit ring buffer.  Transfers on
+ * the bulk out endpoint, which the host sends on, are kept scheduled while the
+ * receive ring has room for a packet, so data arrives while usb_HandleEvents()
+ * runs.  Written data is sent on the bulk in endpoint.
+ * @param srl Serial device state to initialize.
+ * @param dev usb_RootHub.
+ * @param buffer Buffer that must remain valid while \p srl is in use.
+ * @param size Size of \p buffer, each half must hold more than one packet.
+ * @param interface SRL_INTERFACE_DEVICE.
+ * @return USB_SUCCESS, USB_ERROR_NO_DEVICE if the host has not selected the
+ * configuration yet, USB_ERROR_NOT_SUPPORTED for any other interface, or an
+ * error.
+ * @note Host role is deferred, see SRL_INTERFACE_DEVICE.  After a bus reset or
+ * a new configuration, the transfers fail and srl_Init() must be called again.
+ */
+usb_error_t srl_Init(srl_device_t *srl, usb_device_t dev, void *buffer,
+                     size_t size, uint8_t interface);
+
+/**
+ * Sets the baud rate, with 8 data bits, no parity, and 1 stop bit.
+ * @param srl Serial device.
+ * @param rate Baud rate.
+ * @return USB_SUCCESS or an error.
+ * @note In device role the host chooses the rate, so this only records it.
+ */
+usb_error_t srl_SetRate(srl_device_t *srl, uint24_t rate);
 
+/**
+ * Copies received data out of the receive ring, without waiting.
+ * @param srl Serial device.
+ * @param data Buffer to copy to.
+ * @param length Max number of bytes to copy.
+ * @return Number of bytes read, or -1 if nothing was read and a transfer
+ * failed.
+ */
+int srl_Read(srl_device_t *srl, void *data, size_t length);
+
+/**
+ * Queues data in the transmit ring and starts sending it, without waiting.
+ * @param srl Serial device.
+ * @param data Data to send.
+ * @param length Number of bytes to send.
+ * @return Number of bytes queued, which is less than \p length when the ring
+ * is full, or -1 if a transfer failed.
+ */
+int srl_Write(srl_device_t *srl, const void *data, size_t length);
+
+/**
+ * Gets descriptors for the calculator to act as a CDC ACM device, with bulk
+ * endpoints 0x81 and 0x02, to pass to usb_Init().
+ * @return Standard descriptors.
+ * @note The event callback must return USB_SUCCESS for USB_DEFAULT_SETUP_EVENT
+ * so that the host's class requests are acknowledged.
+ */
+const usb_standard_descriptors_t *srl_GetCDCStandardDescriptors(void);
 
 #ifdef __cplusplus
 }
@@ -13,6 +13,7 @@ extern void (*__print_xputch)(char);
 
 void __print_sendstring(char *sp);
 void __print_putch(char ch);
+void __print_float(double d);
 
 int _u_print(char *dest, char *fmt, va_list argp) {
     char *sp;
@@ -64,11 +65,7 @@ int _u_print(char *dest, char *fmt, va_list argp) {
                     case 'g':
                     case 'G':
                         d = va_arg(argp,double);
-                        if (__print_fmt.type == (char)'g') {
-                            _u_dtog(d);
-                        } else {
-                            _u_dtof(d);
-                        }
+                        __print_float(d);
                         break;
                     case 'c':
                         __print_buff[0] = va_arg(argp,int);
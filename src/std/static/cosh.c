@@ -0,0 +1,32 @@
+/************************************************************************/
+/*									*/
+/*			Copyright (C)1987-2008 by				*/
+/*		            Zilog, Inc.           			*/
+/*									*/
+/*		        San Jose, California     			*/
+/*									*/
+/************************************************************************/
+/*
+	cosh(arg) is computed from the exponential function for
+	all arguments.
+*/
+
+#include <math.h>
+
+double cosh(double arg) {
+	double val;
+
+	if(arg < 0) {
+		arg = -arg;
+	}
+
+	val = exp(arg);
+
+	if(arg > 21.) {
+		return(val/2);
+	}
+
+	val += exp(-arg);
+	val /= 2;
+	return(val);
+}
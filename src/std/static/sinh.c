@@ -15,9 +15,6 @@
 
 	A series is used for arguments smaller in magnitude than 0.5.
 	The coefficients are #2029 from Hart & Cheney. (20.36D)
-
-	cosh(arg) is computed from the exponential function for
-	all arguments.
 */
 
 #include <math.h>
@@ -57,21 +54,3 @@ double sinh(double arg) {
 	temp /= (((argsq+q2)*argsq+q1)*argsq+q0);
 	return(sign*temp);
 }
-
-double cosh(double arg) {
-	double val;
-
-	if(arg < 0) {
-		arg = -arg;
-	}
-
-	val = exp(arg);
-
-	if(arg > 21.) {
-		return(val/2);
-	}
-
-	val += exp(-arg);
-	val /= 2;
-	return(val);
-}
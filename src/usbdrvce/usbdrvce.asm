@@ -32,6 +32,9 @@ library 'USBDRVCE', 0
 	export usb_GetEndpointTransferType
 	export usb_SetEndpointFlags
 	export usb_GetEndpointFlags
+	export usb_GetPoolStats
+	export usb_ScheduleTransfer
+	export usb_ScheduleTransfers
 ;-------------------------------------------------------------------------------
 
 ;-------------------------------------------------------------------------------
@@ -44,13 +47,13 @@ struc transfer			; transfer structure
 	.status		rb 1	; transfer status
 	.type		rb 1	; transfer type or 3 shl 2 or last shl 7
 	.remaining	rw 1	; transfer remaining length
-	label .buffers: 20	; transfer buffers
-			rw 1
-	.callback	rd 1	; user callback
-	.data		rd 1	; user callback data
-	.length		rd 1	; original transfer length
-	.endpoint	rd 1	; pointer to endpoint structure
-			rw 1
+	.ptr		rd 1	; current buffer pointer
+	.left		rl 1	; bytes left to transfer in device role
+	.callback	rl 1	; user callback
+	.data		rl 1	; user callback data
+	.length		rl 1	; original transfer length
+	.endpoint	rl 1	; pointer to endpoint structure
+			rb 1
 	assert $-. = 32
 end struc
 struc endpoint			; endpoint structure
@@ -69,6 +72,8 @@ struc endpoint			; endpoint structure
 	.last		rl 1	; pointer to last dummy transfer
 	.device		rl 1	; pointer to device
 	.data		rl 1	; user data
+	.fifo		rb 1	; fifo used in device role
+	.dir		rb 1	; direction shl 7 in device role
 	assert $-. <= 64
 end struc
 struc device			; device structure
@@ -105,7 +110,7 @@ struc stdDesc
 	.strings	rl 1
 	size := $-.
 end struc
-iterate type, endpoint, device, setup, stdDesc
+iterate type, transfer, endpoint, device, setup, stdDesc
  iterate <base,name>, 0,, ix,x, iy,y
   virtual at base
 	name#type type
@@ -136,6 +141,18 @@ virtual at usbArea
 	selectedConfiguration	rb 1
 	freeList32Align32	rl 1
 	freeList64Align256	rl 1
+	poolLimits		rb 2	; max endpoints, max transfers, 0 if no limit
+	poolStats:
+	pool64Align256		rl 1	; endpoints in pool
+	pool64Align256.used	rl 1	; endpoints allocated
+	pool64Align256.peak	rl 1	; most endpoints allocated at once
+	pool32Align32		rl 1	; transfers in pool
+	pool32Align32.used	rl 1	; transfers allocated
+	pool32Align32.peak	rl 1	; most transfers allocated at once
+	poolStats.size := $ - poolStats
+	fifoEndpoints		rl 4	; endpoint using each fifo, odd if none
+				rb (-$) and 31
+	endpointTable		rb 32	; root device endpoints in device role
 	assert $ <= usbInited
 end virtual
 virtual at (ramCodeTop+$FF) and not $FF
@@ -220,6 +237,18 @@ virtual at 0
 	USB_HOST_ASYNC_ADVANCE_INTERRUPT			rb 1
 end virtual
 
+; enum usb_transfer_status
+virtual at 0
+	USB_TRANSFER_COMPLETED			rb 1
+	USB_TRANSFER_ERROR			rb 1
+	USB_TRANSFER_TIMED_OUT			rb 1
+	USB_TRANSFER_STALL			rb 1
+	USB_TRANSFER_NO_DEVICE			rb 1
+	USB_TRANSFER_OVERFLOW			rb 1
+	USB_TRANSFER_MEMORY_ERROR		rb 1
+	USB_TRANSFER_HOST_ERROR			rb 1
+end virtual
+
 ; enum usb_find_flag
 SKIP_NONE		:= 0
 SKIP_DISABLED		:= 1 shl 0
@@ -295,6 +324,13 @@ usb_Init:
 	ld	a,1
 	call	_Init
 	set	5,(hl)
+	ld	hl,endpointTable
+	ld	(rootDevice.endpoints),hl
+	ld	b,32
+.noEndpoints:
+	ld	(hl),$FF
+	inc	l
+	djnz	.noEndpoints
 	xor	a,a
 	sbc	hl,hl
 	ld	(rootDevice.data),hl
@@ -304,7 +340,18 @@ usb_Init:
 	ld	c,9
 	ldir
 	ld	e,(hl)
-	dec	bc
+	inc	hl
+	ld	bc,(hl)
+	ld	hl,poolLimits
+	ld	(hl),c
+	inc	hl
+	ld	(hl),b
+	or	a,a
+	sbc	hl,hl
+iterate stat, pool64Align256, pool64Align256.used, pool64Align256.peak, pool32Align32, pool32Align32.used, pool32Align32.peak
+	ld	(stat),hl
+end iterate
+	ld	bc,-1
 	ld	hl,(standardDescriptors)
 	add	hl,bc
 	jq	c,.nonDefaultStandardDescriptors
@@ -324,9 +371,9 @@ usb_Init:
 	ld	l,usbCxImr-$100
 	ld	(hl),a;0
 	ld	l,usbFifoRxImr-$100
-	ld	(hl),a;0
+	ld	(hl),bmUsbFifoRxInts
 	ld	l,usbFifoTxImr-$100
-	ld	(hl),a;0
+	ld	(hl),bmUsbFifoTxInts
 	ld	l,usbDevImr-$100
 	ld	(hl),a;0
 	inc	l;usbDevImr+1-$100
@@ -366,17 +413,61 @@ usb_Init:
 	sbc	hl,hl
 	add	hl,de
 .outer:
-	call	_Free64Align256
+	call	.endpointBlock
 .inner:
 	sub	a,-32
 	ld	l,a
-	call	c,_Free32Align32
+	call	c,.transferBlock
 	jq	c,.inner
 	inc	h
 	djnz	.outer
 	sbc	hl,hl
 	ret
 
+; Adds a block to the endpoint pool, or to the transfer pool once the endpoint
+; limit is reached.
+; Input:
+;  hl = 256 byte aligned block
+; Output:
+;  flags and registers preserved
+.endpointBlock:
+	push	af
+	ld	a,(poolLimits+0)
+	or	a,a
+	jq	z,.endpoint
+	push	hl
+	ld	hl,(pool64Align256)
+	cp	a,l
+	pop	hl
+	jq	z,.noEndpoint
+.endpoint:
+	pop	af
+	jq	_Free64Align256.add
+.noEndpoint:
+	pop	af
+
+; Adds a block to the transfer pool, unless the transfer limit is reached.
+; Input:
+;  hl = 32 byte aligned block
+; Output:
+;  flags and registers preserved
+.transferBlock:
+	push	af
+	ld	a,(poolLimits+1)
+	or	a,a
+	jq	z,.transfer
+	push	hl
+	ld	hl,(pool32Align32)
+	cp	a,l
+	pop	hl
+	jq	z,.full
+.transfer:
+	pop	af
+	jq	_Free32Align32.add
+.full:
+	pop	af
+	ret
+
 ;-------------------------------------------------------------------------------
 usb_Cleanup:
 	xor	a,a
@@ -607,6 +698,124 @@ usb_GetEndpointFlags:
 	ld	a,(yendpoint.flags)
 	jp	(hl)
 
+;-------------------------------------------------------------------------------
+usb_GetPoolStats:
+	pop	de
+	ex	(sp),hl
+	push	de
+	ex	de,hl
+	ld	hl,poolStats
+	ld	bc,poolStats.size
+	ldir
+	ret
+
+;-------------------------------------------------------------------------------
+usb_ScheduleTransfer:
+	ld	iy,0
+	add	iy,sp
+	ld	hl,(iy+15)
+	push	hl		; data
+	ld	hl,(iy+9)
+	push	hl		; length
+	ld	hl,(iy+6)
+	push	hl		; buffer
+	ld	hl,0
+	add	hl,sp
+	ld	de,(iy+12)
+	push	de		; handler
+	ld	de,1
+	push	de		; count
+	push	hl		; buffers
+	ld	hl,(iy+3)
+	push	hl		; endpoint
+	call	usb_ScheduleTransfers
+	ld	iy,21
+	add	iy,sp
+	ld	sp,iy
+	ret
+
+;-------------------------------------------------------------------------------
+usb_ScheduleTransfers:
+	call	_Check
+	push	ix
+	ld	ix,0
+	add	ix,sp
+	ld	iy,(ix+6)
+	ld	hl,USB_ERROR_INVALID_PARAM
+	ld	a,iyl
+	cp	a,endpoint and $FF
+	jq	nz,.return
+	ld	hl,USB_ERROR_NOT_SUPPORTED
+	ld	a,(yendpoint.type)
+	or	a,a
+	jq	z,.return
+	ld	hl,(pool32Align32)
+	ld	de,(pool32Align32.used)
+	or	a,a
+	sbc	hl,de
+	ld	bc,(ix+12)
+	sbc	hl,bc
+	ld	hl,USB_ERROR_NO_MEMORY
+	jq	c,.return
+	sbc	hl,hl
+	adc	hl,bc
+	jq	z,.return
+	ld	hl,(ix+9)
+	ld	de,5
+	add	hl,de
+	ld	e,9
+.length:
+	ld	a,(hl)
+	cp	a,1+(bmUsbDmaLen shr 16)
+	jq	nc,.invalid
+	add	hl,de
+	dec	bc
+	ld	a,b
+	or	a,c
+	jq	nz,.length
+.queue:
+	call	_Alloc32Align32
+	ld	bc,(ix+15)
+	ld	de,(ix+9)
+	push	ix,hl
+	pop	ix
+	ld	(xtransfer.callback),bc
+	ex	de,hl
+	ld	de,(hl)
+	ld	(xtransfer.ptr),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(hl)
+	ld	(xtransfer.length),de
+	ld	(xtransfer.left),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	de,(hl)
+	ld	(xtransfer.data),de
+	inc	hl
+	inc	hl
+	inc	hl
+	ld	(xtransfer.endpoint),iy
+	push	hl
+	call	_QueueTransfer
+	pop	hl
+	pop	ix
+	ld	(ix+9),hl
+	ld	hl,(ix+12)
+	dec	hl
+	ld	(ix+12),hl
+	ld	a,h
+	or	a,l
+	jq	nz,.queue
+	jq	.return
+.invalid:
+	ld	hl,USB_ERROR_INVALID_PARAM
+.return:
+	pop	ix
+	ret
+
 _Check:
 	call	.check
 	ret	z
@@ -666,16 +875,48 @@ _Alloc#size#Align#align:
 	ld	hl,(freeList#size#Align#align)
 	bit	0,l
 	ret	nz
-	push	hl
+	push	de,hl
 	ld	hl,(hl)
 	ld	(freeList#size#Align#align),hl
-	pop	hl
+	ld	hl,(pool#size#Align#align.used)
+	inc	hl
+	ld	(pool#size#Align#align.used),hl
+	ld	de,(pool#size#Align#align.peak)
+	or	a,a
+	sbc	hl,de
+	jq	c,.notPeak
+	add	hl,de
+	ld	(pool#size#Align#align.peak),hl
+.notPeak:
+	pop	hl,de
+	cp	a,a
 	ret
 
 ; Frees an <align> byte aligned <size> byte block.
 ; Input:
 ;  hl = allocated memory to be freed.
+; Output:
+;  flags preserved
 _Free#size#Align#align:
+	push	hl
+	ld	hl,(pool#size#Align#align.used)
+	dec	hl
+	ld	(pool#size#Align#align.used),hl
+	pop	hl
+	jq	.push
+
+; Adds a new <align> byte aligned <size> byte block to the pool.
+; Input:
+;  hl = block
+; Output:
+;  flags preserved
+.add:
+	push	hl
+	ld	hl,(pool#size#Align#align)
+	inc	hl
+	ld	(pool#size#Align#align),hl
+	pop	hl
+.push:
 	push	de
 	ld	de,(freeList#size#Align#align)
 	ld	(hl),de
@@ -685,6 +926,465 @@ _Free#size#Align#align:
 
 end iterate
 
+; Sets up the endpoints of a configuration selected by the host.
+; Input:
+;  a = configuration value, or 0 to deconfigure
+; Output:
+;  zf = configuration exists
+;  de, hl preserved
+_SetConfiguration:
+	push	hl,de
+	ld	iy,(standardDescriptors)
+	ld	hl,(ystdDesc.device)
+	ld	bc,17
+	add	hl,bc
+	cp	a,(hl)
+	jq	z,.exists
+	jq	nc,.return
+.exists:
+	ld	(selectedConfiguration),a
+	push	af
+	call	_Deconfigure
+	pop	af
+	or	a,a
+	jq	z,.return
+	dec	a
+	ld	c,a
+	ld	b,3
+	mlt	bc
+	ld	iy,(standardDescriptors)
+	ld	hl,(ystdDesc.configurations)
+	add	hl,bc
+	ld	hl,(hl)
+	push	hl
+	inc	hl
+	inc	hl
+	ld	de,0
+	ld	e,(hl)
+	inc	hl
+	ld	d,(hl)
+	pop	hl
+	ex	de,hl
+	add	hl,de
+	ex	de,hl			; de = end of configuration
+	ld	c,0			; c = next free fifo
+.descriptor:
+	or	a,a
+	sbc	hl,de
+	add	hl,de
+	jq	nc,.configured
+	ld	a,(hl)
+	or	a,a
+	jq	z,.configured
+	push	hl
+	inc	hl
+	ld	a,(hl)
+	dec	hl
+	cp	a,ENDPOINT_DESCRIPTOR
+	call	z,_AddEndpoint
+	pop	hl
+	ld	a,(hl)
+	push	bc
+	ld	bc,0
+	ld	c,a
+	add	hl,bc
+	pop	bc
+	jq	.descriptor
+.configured:
+	ld	hl,mpUsbGimr
+	res	bUsbDevIntFifo,(hl)
+	cp	a,a
+.return:
+	pop	de,hl
+	ret
+
+; Cancels the transfers of the configured endpoints and frees them.
+_Deconfigure:
+	push	ix
+	ld	hl,mpUsbGimr
+	set	bUsbDevIntFifo,(hl)
+	ld	bc,4 shl 8
+.fifo:
+	push	bc
+	ld	b,3
+	mlt	bc
+	ld	hl,fifoEndpoints
+	add	hl,bc
+	ld	iy,(hl)
+	ld	de,1
+	ld	(hl),de
+	ld	a,iyl
+	rrca
+	jq	c,.next
+.cancel:
+	ld	ix,(yendpoint.first)
+	ld	a,ixl
+	rrca
+	jq	c,.free
+	ld	a,USB_TRANSFER_NO_DEVICE
+	call	_CompleteTransfer
+	jq	.cancel
+.free:
+	call	_StopEndpoint
+	ld	a,(yendpoint.fifo)
+	ld	hl,mpUsbFifo0Cfg
+	add	a,l
+	ld	l,a
+	ld	(hl),0
+	ld	a,(yendpoint.info)
+	add	a,a
+	bit	7,(yendpoint.dir)
+	jq	z,.out
+	inc	a
+.out:
+	ld	hl,endpointTable
+	or	a,l
+	ld	l,a
+	ld	(hl),$FF
+	lea	hl,iy-endpoint
+	call	_Free64Align256
+.next:
+	pop	bc
+	inc	c
+	djnz	.fifo
+	ld	hl,mpUsbEp1Map
+	ld	b,8
+.map:
+	ld	(hl),$FF
+	inc	hl
+	djnz	.map
+	pop	ix
+	ret
+
+; Sets up an endpoint of the selected configuration on the next free fifo.
+; Input:
+;  c = next free fifo
+;  hl = endpoint descriptor
+; Output:
+;  c = next free fifo
+;  de preserved
+_AddEndpoint:
+	ld	a,c
+	cp	a,4
+	ret	nc
+	push	de,ix
+	push	hl
+	pop	ix
+	ld	a,(ix+2);bEndpointAddress
+	and	a,$0F
+	jq	z,.return
+	cp	a,9
+	jq	nc,.return
+	ld	a,(ix+5);wMaxPacketSize+1
+	and	a,111b
+	or	a,(ix+4);wMaxPacketSize
+	jq	z,.return
+	call	_Alloc64Align256
+	jq	nz,.return
+	dec	hl
+	dec	hl
+	push	hl
+	pop	iy
+	ld	a,(ix+2)
+	and	a,$0F
+	ld	(yendpoint.info),a
+	ld	a,(ix+2)
+	and	a,$80
+	ld	(yendpoint.dir),a
+	ld	a,(ix+3);bmAttributes
+	and	a,3
+	ld	(yendpoint.type),a
+	ld	a,(ix+4)
+	ld	(yendpoint.maxPktLen+0),a
+	ld	a,(ix+5)
+	and	a,111b
+	ld	(yendpoint.maxPktLen+1),a
+	ld	(yendpoint.fifo),c
+	xor	a,a
+	ld	(yendpoint.flags),a
+	ld	(yendpoint.internalFlags),a
+	sbc	hl,hl
+	ld	(yendpoint.data),hl
+	inc	hl
+	ld	(yendpoint.first),hl
+	ld	hl,rootDevice
+	ld	(yendpoint.device),hl
+	ld	a,(ix+2)
+	rlca
+	and	a,$1F
+	ld	hl,endpointTable
+	or	a,l
+	ld	l,a
+	ld	a,iyh
+	ld	(hl),a
+	push	bc
+	ld	b,3
+	mlt	bc
+	ld	hl,fifoEndpoints
+	add	hl,bc
+	ld	(hl),iy
+	pop	bc
+	ld	hl,mpUsbFifo0Map
+	ld	a,l
+	add	a,c
+	ld	l,a
+	ld	a,(yendpoint.info)
+	bit	7,(yendpoint.dir)
+	jq	z,.fifoOut
+	or	a,usbFifoIn
+.fifoOut:
+	ld	(hl),a
+	ld	a,l
+	add	a,usbFifo0Cfg-usbFifo0Map
+	ld	l,a
+	ld	b,usbFifo1Blk or usbFifoBlkSz512 or bmUsbFifoEn
+	ld	a,(yendpoint.maxPktLen+1)
+	cp	a,2
+	jq	c,.blockSize
+	jq	nz,.bigBlock
+	ld	a,(yendpoint.maxPktLen+0)
+	or	a,a
+	jq	z,.blockSize
+.bigBlock:
+	ld	b,usbFifo1Blk or usbFifoBlkSz1024 or bmUsbFifoEn
+.blockSize:
+	ld	a,(yendpoint.type)
+	or	a,b
+	ld	(hl),a
+	ld	a,(yendpoint.info)
+	ld	hl,mpUsbEp1Map-1
+	add	a,l
+	ld	l,a
+	ld	a,c
+	bit	7,(yendpoint.dir)
+	jq	nz,.mapIn
+	rlca
+	rlca
+	rlca
+	rlca
+	xor	a,(hl)
+	and	a,bmUsbEpMapOut
+	jq	.mapped
+.mapIn:
+	xor	a,(hl)
+	and	a,bmUsbEpMapIn
+.mapped:
+	xor	a,(hl)
+	ld	(hl),a
+	ld	a,(yendpoint.info)
+	ld	hl,mpUsbInEp1-4
+	bit	7,(yendpoint.dir)
+	jq	nz,.epIn
+	ld	l,usbOutEp1-4-$100
+.epIn:
+	add	a,a
+	add	a,a
+	add	a,l
+	ld	l,a
+	ld	a,(yendpoint.maxPktLen+0)
+	ld	(hl),a
+	inc	hl
+	ld	a,(yendpoint.maxPktLen+1)
+	or	a,bmUsbEpReset shr 8
+	ld	(hl),a
+	xor	a,bmUsbEpReset shr 8
+	ld	(hl),a
+	inc	c
+.return:
+	pop	ix,de
+	ret
+
+; Appends a transfer to the queue of its endpoint.
+; Input:
+;  ix = transfer
+;  iy = endpoint
+; Output:
+;  zf set
+_QueueTransfer:
+	ld	hl,1
+	ld	(xtransfer.next),hl
+	ld	hl,(yendpoint.first)
+	bit	0,l
+	jq	z,.append
+	ld	(yendpoint.first),ix
+	jq	.tail
+.append:
+	ld	hl,(yendpoint.last)
+	ld	(hl),ix
+.tail:
+	ld	(yendpoint.last),ix
+
+; Lets the fifo interrupts of an endpoint through.
+; Input:
+;  iy = endpoint
+; Output:
+;  zf set
+_StartEndpoint:
+	call	_FifoImr
+	cpl
+	and	a,(hl)
+	ld	(hl),a
+	cp	a,a
+	ret
+
+; Masks the fifo interrupts of an endpoint.
+; Input:
+;  iy = endpoint
+; Output:
+;  bc, de preserved
+_StopEndpoint:
+	call	_FifoImr
+	or	a,(hl)
+	ld	(hl),a
+	ret
+
+; Acknowledges the fifo interrupts of an endpoint.
+; Input:
+;  iy = endpoint
+_AckFifo:
+	call	_FifoImr
+	ld	bc,usbFifoRxIsr-usbFifoRxImr
+	add	hl,bc
+	ld	(hl),a
+	ret
+
+; Finds the fifo interrupt mask bits of an endpoint.
+; Input:
+;  iy = endpoint
+; Output:
+;  a = mask bits
+;  hl = mask register
+;  bc, de preserved
+_FifoImr:
+	ld	a,(yendpoint.fifo)
+	ld	hl,mpUsbFifoTxImr
+	bit	7,(yendpoint.dir)
+	jq	nz,_FifoBit
+	ld	l,usbFifoRxImr-$100
+	add	a,a
+	call	_FifoBit
+	push	bc
+	ld	b,a
+	add	a,a
+	or	a,b
+	pop	bc
+	ret
+
+; Input:
+;  a = bit number
+; Output:
+;  a = 1 shl bit number
+;  bc, de, hl preserved
+_FifoBit:
+	push	bc
+	ld	b,a
+	inc	b
+	xor	a,a
+	scf
+.shift:
+	rla
+	djnz	.shift
+	pop	bc
+	ret
+
+; Copies between memory and the fifo of an endpoint, in its direction.
+; Input:
+;  bc = length
+;  de = memory
+;  iy = endpoint
+; Output:
+;  bc preserved
+_DmaFifo:
+	ld	a,(yendpoint.fifo)
+	call	_FifoBit
+	ld	hl,mpUsbDmaFifo
+	ld	(hl),a
+	ld	l,usbDmaAddr-$100
+	ld	(hl),de
+	ld	l,usbDmaCtrl-$100
+	ld	a,(yendpoint.dir)
+	rlca
+	rlca
+	xor	a,(hl)
+	and	a,bmUsbDmaDir
+	xor	a,(hl)
+	ld	(hl),a
+	inc	l;usbDmaLen-$100
+	ld	(hl),bc
+	dec	l;usbDmaCtrl-$100
+	set	bUsbDmaStart,(hl)
+	ld	l,usbDevIsr-$100
+.wait:
+	bit	bUsbIntDevDmaFin,(hl)
+	jq	z,.wait
+	ld	(hl),bmUsbIntDevDmaFin
+	ld	l,usbDmaFifo-$100
+	ld	(hl),bmUsbDmaNoFifo
+	ret
+
+; Removes the first transfer of an endpoint and calls its callback.
+; Input:
+;  a = status
+;  ix = transfer
+;  iy = endpoint
+; Output:
+;  zf = success
+;  hl = error
+_CompleteTransfer:
+	ld	c,a
+	ld	hl,(xtransfer.next)
+	ld	(yendpoint.first),hl
+	bit	0,l
+	call	nz,_StopEndpoint
+	ld	hl,(xtransfer.length)
+	ld	de,(xtransfer.left)
+	or	a,a
+	sbc	hl,de
+	push	iy
+	ld	de,(xtransfer.data)
+	push	de,hl
+	ld	de,0
+	ld	e,c
+	push	de,iy
+	ld	hl,(xtransfer.callback)
+	call	.dispatch
+	pop	de,bc,de,de
+	pop	iy
+	ld	de,USB_IGNORE
+	or	a,a
+	sbc	hl,de
+	jq	z,.restart
+	add	hl,de
+.free:
+	push	hl
+	lea	hl,ix
+	call	_Free32Align32
+	pop	hl
+	add	hl,de
+	or	a,a
+	sbc	hl,de
+	ret
+.restart:
+	ld	a,c
+	cp	a,USB_TRANSFER_NO_DEVICE
+	jq	z,.free
+	ld	hl,(xtransfer.length)
+	ld	de,(xtransfer.left)
+	or	a,a
+	sbc	hl,de
+	ex	de,hl
+	ld	hl,(xtransfer.ptr)
+	or	a,a
+	sbc	hl,de
+	ld	(xtransfer.ptr),hl
+	ld	hl,(xtransfer.length)
+	ld	(xtransfer.left),hl
+	call	_QueueTransfer
+	sbc	hl,hl
+	ret
+.dispatch:
+	jp	(hl)
+
 _HandleGetDescriptor:
 	ld	de,(ysetup.wIndex)
 	ld	bc,(ysetup.wValue)
@@ -867,8 +1567,12 @@ _HandleCxSetupInt:
 	or	a,c
 	or	a,b
 	jq	nz,_HandleCxSetupInt.unhandled
-	cpl
-	add	a,e
+	ld	a,e
+	call	_SetConfiguration
+	jq	nz,_HandleCxSetupInt.unhandled
+	ld	a,e
+	cp	a,1
+	ccf
 	ld	l,usbDevAddr-$100
 	ld	a,(hl)
 	rla
@@ -1023,67 +1727,163 @@ _HandleCxAbortInt:
 	ld	a,USB_CONTROL_ABORT_INTERRUPT
 	jq	_DispatchEvent
 
-_HandleFifo0OutInt:
-	ld	(hl),bmUsbIntFifo0Out
-	ld	a,USB_FIFO0_OUTPUT_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo0SpkInt:
-	ld	(hl),bmUsbIntFifo0Spk
-	ld	a,USB_FIFO0_SHORT_PACKET_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo1OutInt:
-	ld	(hl),bmUsbIntFifo1Out
-	ld	a,USB_FIFO1_OUTPUT_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo1SpkInt:
-	ld	(hl),bmUsbIntFifo1Spk
-	ld	a,USB_FIFO1_SHORT_PACKET_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo2OutInt:
-	ld	(hl),bmUsbIntFifo2Out
-	ld	a,USB_FIFO2_OUTPUT_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo2SpkInt:
-	ld	(hl),bmUsbIntFifo2Spk
-	ld	a,USB_FIFO2_SHORT_PACKET_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo3OutInt:
-	ld	(hl),bmUsbIntFifo3Out
-	ld	a,USB_FIFO3_OUTPUT_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo3SpkInt:
-	ld	(hl),bmUsbIntFifo3Spk
-	ld	a,USB_FIFO3_SHORT_PACKET_INTERRUPT
-	jq	_DispatchEvent
-
-_HandleFifo0InInt:
-	ld	(hl),bmUsbIntFifo0In
-	ld	a,USB_FIFO0_INPUT_INTERRUPT
+repeat 4, fifo: 0
+ iterate <type,event,service>, Out,OUTPUT,Out, Spk,SHORT_PACKET,Out, In,INPUT,In
+_HandleFifo#fifo#type#Int:
+	ld	iy,(fifoEndpoints+fifo*3)
+	ld	a,iyl
+	rrca
+	jq	nc,_HandleFifo#service
+	ld	(hl),bmUsbIntFifo#fifo#type
+	ld	a,USB_FIFO#fifo#_#event#_INTERRUPT
 	jq	_DispatchEvent
 
-_HandleFifo1InInt:
-	ld	(hl),bmUsbIntFifo1In
-	ld	a,USB_FIFO1_INPUT_INTERRUPT
-	jq	_DispatchEvent
+ end iterate
+end repeat
 
-_HandleFifo2InInt:
-	ld	(hl),bmUsbIntFifo2In
-	ld	a,USB_FIFO2_INPUT_INTERRUPT
-	jq	_DispatchEvent
+; Sends the first transfer of an IN endpoint through its fifo.
+; Input:
+;  hl = usbFifoTxIsr
+;  iy = endpoint
+; Output:
+;  zf = success
+;  hl = error, or preserved
+_HandleFifoIn:
+	push	hl,ix
+	ld	ix,(yendpoint.first)
+	ld	a,ixl
+	rrca
+	jq	c,_HandleFifoOut.idle
+	call	_AckFifo
+	ld	bc,(xtransfer.left)
+	ld	a,(xtransfer.left+2)
+	or	a,b
+	or	a,c
+	jq	z,.zlp
+	ld	de,(xtransfer.ptr)
+	call	_DmaFifo
+	ld	hl,(xtransfer.ptr)
+	add	hl,bc
+	ld	(xtransfer.ptr),hl
+	bit	bsf MANUAL_TERMINATE,(yendpoint.flags)
+	jq	nz,.sent
+	or	a,a
+	sbc	hl,hl
+	ex	de,hl
+	ld	e,(yendpoint.maxPktLen+0)
+	ld	d,(yendpoint.maxPktLen+1)
+	push	bc
+	pop	hl
+.multiple:
+	sbc	hl,de
+	jq	z,.zlp
+	jq	nc,.multiple
+	jq	.sent
+.zlp:
+	ld	a,(yendpoint.info)
+	ld	hl,mpUsbInEp1+1-4
+	add	a,a
+	add	a,a
+	add	a,l
+	ld	l,a
+	set	bUsbInEpSendZlp-8,(hl)
+.sent:
+	or	a,a
+	sbc	hl,hl
+	ld	(xtransfer.left),hl
+	xor	a,a;USB_TRANSFER_COMPLETED
+	call	_CompleteTransfer
+	jq	_HandleFifoOut.return
 
-_HandleFifo3InInt:
-	ld	(hl),bmUsbIntFifo3In
-	ld	a,USB_FIFO3_INPUT_INTERRUPT
-	jq	_DispatchEvent
+; Receives a packet from the fifo of an OUT endpoint into its first transfer.
+; Input:
+;  hl = usbFifoRxIsr
+;  iy = endpoint
+; Output:
+;  zf = success
+;  hl = error, or preserved
+_HandleFifoOut:
+	push	hl,ix
+	ld	ix,(yendpoint.first)
+	ld	a,ixl
+	rrca
+	jq	c,.idle
+	call	_AckFifo
+	ld	a,(yendpoint.fifo)
+	ld	hl,mpUsbFifo0Csr
+	add	a,a
+	add	a,a
+	add	a,l
+	ld	l,a
+	ld	bc,0
+	ld	c,(hl)
+	inc	hl
+	ld	a,(hl)
+	and	a,bmUsbFifoLen shr 8
+	ld	b,a
+	ld	hl,(xtransfer.left)
+	or	a,a
+	sbc	hl,bc
+	jq	c,.overflow
+	ld	(xtransfer.left),hl
+	call	.receive
+	ld	hl,(xtransfer.left)
+	ld	de,1
+	or	a,a
+	sbc	hl,de
+	jq	c,.completed
+	or	a,a
+	sbc	hl,hl
+	ld	l,(yendpoint.maxPktLen+0)
+	ld	h,(yendpoint.maxPktLen+1)
+	sbc	hl,bc
+	jq	z,.idle
+	jq	c,.idle
+.completed:
+	xor	a,a;USB_TRANSFER_COMPLETED
+	jq	.complete
+.overflow:
+	ld	bc,(xtransfer.left)
+	call	.receive
+	or	a,a
+	sbc	hl,hl
+	ld	(xtransfer.left),hl
+	ld	a,(yendpoint.fifo)
+	ld	hl,mpUsbFifo0Csr+1
+	add	a,a
+	add	a,a
+	add	a,l
+	ld	l,a
+	set	bUsbFifoReset-8,(hl)
+	ld	a,USB_TRANSFER_OVERFLOW
+.complete:
+	call	_CompleteTransfer
+.return:
+	pop	ix
+	jq	nz,.error
+	pop	hl
+	ret
+.error:
+	pop	de
+	ret
+.idle:
+	cp	a,a
+	jq	.return
+.receive:
+	ld	a,b
+	or	a,c
+	ret	z
+	ld	de,(xtransfer.ptr)
+	call	_DmaFifo
+	ld	hl,(xtransfer.ptr)
+	add	hl,bc
+	ld	(xtransfer.ptr),hl
+	ret
 
 _HandleDevResetInt:
+	push	hl
+	call	_Deconfigure
+	pop	hl
 	xor	a,a
 	ld	(selectedConfiguration),a
 	ld	(mpUsbDevAddr),a
@@ -28,6 +28,18 @@ typedef enum usb_init_flags {
   USB_DEFAULT_INIT_FLAGS = USB_USE_USB_AREA | USB_USE_OS_HEAP,
 } usb_init_flags_t;
 
+/**
+ * Limits the endpoint pool built by usb_Init() to \p count endpoints, from 1 to
+ * 255.  Memory that would have held more endpoints holds transfers instead.
+ * Combine with the other \c usb_init_flags_t using |.
+ */
+#define USB_INIT_MAX_ENDPOINTS(count) ((usb_init_flags_t)((count) << 8))
+/**
+ * Limits the transfer pool built by usb_Init() to \p count transfers, from 1 to
+ * 255.  Combine with the other \c usb_init_flags_t using |.
+ */
+#define USB_INIT_MAX_TRANSFERS(count) ((usb_init_flags_t)((count) << 16))
+
 typedef enum usb_event {
   /// \p event_data The usb_device_t that was disconnected.
   USB_DEVICE_DISCONNECTED_EVENT,
@@ -374,12 +386,21 @@ typedef struct usb_standard_descriptors {
   usb_string_descriptor_t **strings;
 } usb_standard_descriptors_t;
 
+typedef struct usb_pool_stats {
+  size_t endpoints;      /**< Endpoints in the pool.                          */
+  size_t endpoints_used; /**< Endpoints currently allocated.                  */
+  size_t endpoints_peak; /**< Most endpoints allocated at once.               */
+  size_t transfers;      /**< Transfers in the pool.                          */
+  size_t transfers_used; /**< Transfers currently allocated.                  */
+  size_t transfers_peak; /**< Most transfers allocated at once.               */
+} usb_pool_stats_t;
+
 typedef struct usb_device   *usb_device_t;   /**< opaque  device  handle */
 typedef struct usb_endpoint *usb_endpoint_t; /**< opaque endpoint handle */
 
 #define USB_RETRY_FOREVER 0xFFFFFFu
 
-#define usb_RootHub ((usb_device_t)0xD13FC0u) /**< Root hub device */
+#define usb_RootHub ((usb_device_t)0xD13FE0u) /**< Root hub device */
 
 /**
  * A pointer to \c usb_callback_data_t is passed to the \c usb_event_callback_t.
@@ -469,7 +490,8 @@ typedef usb_error_t (*usb_transfer_callback_t)(usb_endpoint_t endpoint,
  * @param data Opaque pointer to be passed to \p handler.
  * @param device_descriptors A pointer to the device descriptors to use, or
  * NULL to use the calculator's defaults.
- * @param flags Which areas of memory to use.
+ * @param flags Which areas of memory to use, optionally combined with
+ * \c USB_INIT_MAX_ENDPOINTS and \c USB_INIT_MAX_TRANSFERS.
  * @return USB_SUCCESS if initialization succeeded.
  * @note This must be called before any other function, and can be called again
  * to cancel all transfers and disable all devices.
@@ -768,6 +790,14 @@ void usb_SetEndpointFlags(usb_endpoint_t endpoint, usb_endpoint_flag_t flags);
  */
 usb_endpoint_flag_t usb_GetEndpointFlags(usb_endpoint_t endpoint);
 
+/**
+ * Gets the size and usage of the endpoint and transfer pools built by
+ * usb_Init().  The peak counts show how close a program came to running out,
+ * which helps choose \c USB_INIT_MAX_ENDPOINTS and \c USB_INIT_MAX_TRANSFERS.
+ * @param stats Returns the pool statistics.
+ */
+void usb_GetPoolStats(usb_pool_stats_t *stats);
+
 /**
  * Clears an endpoint's halt condition, indicated by transfers to that endpoint
  * stalling.  This function blocks until the halt condition is cleared.
@@ -916,6 +946,14 @@ usb_ScheduleDefaultControlTransfer(/*usb_device_t */device,                    \
  * @param handler Function to be called when the transfer finishes.
  * @param data Opaque pointer to be passed to the \p handler.
  * @return USB_SUCCESS if the transfer was scheduled or an error.
+ * @note Only device role is currently supported, on the endpoints of the
+ * configuration selected by the host, of which the first four get a fifo.
+ * Control endpoints return USB_ERROR_NOT_SUPPORTED, and \p length must be less
+ * than 128 KiB.
+ * @note Host role is not implemented yet.  Attached devices are not
+ * enumerated, so there are no endpoints to schedule transfers on while acting
+ * as usb host, and the control transfers used to talk to devices are
+ * not supported either.
  */
 usb_error_t
 usb_ScheduleTransfer(usb_endpoint_t endpoint, void *buffer, size_t length,
@@ -925,6 +963,32 @@ usb_ScheduleTransfer(usb_endpoint_t endpoint, void *buffer, size_t length,
 #define usb_ScheduleInterruptTransfer usb_ScheduleTransfer
 #define usb_ScheduleIsochronousTransfer usb_ScheduleTransfer
 
+/** One buffer of a usb_ScheduleTransfers() batch. */
+typedef struct usb_transfer_buffer {
+  void *buffer;              /**< Data to transfer that must reside in RAM.   */
+  size_t length;             /**< Number of bytes to transfer.                */
+  usb_transfer_data_t *data; /**< Opaque pointer to be passed to the handler. */
+} usb_transfer_buffer_t;
+
+/**
+ * Schedules a transfer for each of \p count \p buffers on \p endpoint, in
+ * order, as if by calling usb_ScheduleTransfer() for each one.  Either all of
+ * the transfers are scheduled, or none are when the transfer pool doesn't have
+ * room for \p count more.
+ * @param endpoint The endpoint to communicate with.
+ * @param buffers The buffers to transfer, which only need to remain valid until
+ * this returns.  The data they point to must remain valid until the handler is
+ * called for it.
+ * @param count Number of \p buffers.
+ * @param handler Function to be called when each transfer finishes.
+ * @return USB_SUCCESS if the transfers were scheduled or an error.
+ * @note Has the same device role only limits as usb_ScheduleTransfer().
+ */
+usb_error_t
+usb_ScheduleTransfers(usb_endpoint_t endpoint,
+                      const usb_transfer_buffer_t *buffers, size_t count,
+                      usb_transfer_callback_t handler);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,90 @@
+#!/bin/bash
+# Runs the benchmark programs headless in the CEmu autotester and compares the
+# cycle counts they report against the stored baseline.
+#
+# usage: bench.sh [--update] [benchmarks directory]
+#
+# Each benchmark reports "bench <name> <cycles>" lines on the emulator console.
+# A kernel that got slower than its baseline by more than BENCH_THRESHOLD
+# percent (5 by default) fails the run. Without a baseline every kernel is
+# reported as new, along with a warning. --update stores the current results
+# as the new baseline instead.
+
+set -e
+
+update=0
+if [ "$1" == "--update" ]; then
+    update=1
+    shift
+fi
+
+# Grab current path
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+benchdir=${1:-$DIR/../../benchmarks}
+baseline=$benchdir/baseline.txt
+threshold=${BENCH_THRESHOLD:-5}
+
+compare=1
+if [ $update -eq 0 ] && ! grep -qE '^[^#[:space:]]' "$baseline" 2>/dev/null; then
+    echo "warning: no benchmark baseline in $baseline, nothing to compare against"
+    echo "warning: run 'make bench-update' on a known good build to store one"
+    compare=0
+fi
+
+results=$(mktemp)
+trap 'rm -f "$results"' EXIT
+
+failures=0
+for json in "$benchdir"/*/autotester.json; do
+    echo "Launching autotester on $json"
+    output=$(cd "$(dirname "$json")" && autotester autotester.json) || failures=$((failures + 1))
+    echo "$output" | sed -n 's/^.*bench \([^ ]*\) \([0-9]*\).*$/\1 \2/p' >> "$results"
+done
+
+if [ $failures -ne 0 ]; then
+    echo "$failures benchmark program(s) failed to run"
+    exit 1
+fi
+
+if [ $update -eq 1 ]; then
+    {
+        echo "# benchmark baseline: <kernel> <cycles per run>, regenerate with 'make bench-update'"
+        sort "$results"
+    } > "$baseline"
+    echo "Baseline updated with $(wc -l < "$results") kernels"
+    exit 0
+fi
+
+if [ $compare -eq 0 ]; then
+    awk '{ printf "%-32s %10d cycles (new)\n", $1, $2 }' "$results"
+    exit 0
+fi
+
+awk -v threshold="$threshold" '
+    FNR == NR {
+        if ($0 !~ /^#/ && NF == 2) base[$1] = $2
+        next
+    }
+    {
+        if (!($1 in base)) {
+            printf "%-32s %10d cycles (new)\n", $1, $2
+            next
+        }
+        change = base[$1] ? ($2 - base[$1]) * 100 / base[$1] : 0
+        status = ""
+        if (change > threshold) {
+            status = " REGRESSION"
+            regressions++
+        } else if (change < -threshold) {
+            status = " improved"
+        }
+        printf "%-32s %10d cycles %+7.2f%%%s\n", $1, $2, change, status
+    }
+    END {
+        if (regressions) {
+            printf "%d kernel(s) are more than %s%% slower than the baseline\n", regressions, threshold
+            exit 1
+        }
+    }
+' "$baseline" "$results"
@@ -0,0 +1,85 @@
+#!/bin/bash
+# Prints the runtime sources the linker keeps for a program, and why.
+#
+# usage: kept.sh [--static] CEDEV program sources...
+#
+# The linker only keeps a source of the runtime when a kept source references
+# a symbol it defines, starting from the startup code and the program sources,
+# the .src files of the obj directory and the .asm files of the src directory.
+# Each kept source is printed with the symbol that pulled it in and the source
+# referencing it. With --static, the static math sources are used instead of
+# the linked ones, as with USE_FLASH_FUNCTIONS=NO. References under a
+# conditional, such as those of the startup code, are always followed.
+
+set -e
+
+math=linked
+if [ "$1" == "--static" ]; then
+    math=static
+    shift
+fi
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 [--static] CEDEV program sources..." >&2
+    exit 1
+fi
+
+lib="$1/lib"
+shift
+shopt -s nullglob
+
+awk -v nroots=$(($# + 1)) '
+    FNR == 1 {
+        file = FILENAME
+        files[++count] = file
+        root[file] = count <= nroots
+    }
+    {
+        line = $0
+        sub(/;.*/, "", line)
+        sub(/\r$/, "", line)
+        if (match(line, /^[ \t]*(\.[dD][eE][fF]|[xX][dD][eE][fF]|[pP][uU][bB][lL][iI][cC])[ \t]/)) {
+            names = substr(line, RLENGTH + 1)
+            gsub(/[ \t]/, "", names)
+            n = split(names, name, ",")
+            for (i = 1; i <= n; i++) {
+                sub(/:.*/, "", name[i])
+                if (!(name[i] in owner) && !root[file]) owner[name[i]] = file
+            }
+            next
+        }
+        n = split(line, token, /[^A-Za-z0-9_.$]+/)
+        for (i = 1; i <= n; i++) {
+            if (token[i] ~ /^[A-Za-z_.]/) refs[file, token[i]] = 1
+        }
+    }
+    END {
+        for (i = 1; i <= nroots; i++) {
+            queue[++tail] = files[i]
+            kept[files[i]] = 1
+        }
+        while (head < tail) {
+            file = queue[++head]
+            for (key in refs) {
+                split(key, part, SUBSEP)
+                if (part[1] != file || !(part[2] in owner)) continue
+                target = owner[part[2]]
+                if (target in kept) continue
+                kept[target] = 1
+                queue[++tail] = target
+                why[target] = part[2]
+                from[target] = file
+            }
+        }
+        libs = 0
+        for (i = nroots + 1; i <= count; i++) libs++
+        for (i = nroots + 1; i <= tail; i++) {
+            file = queue[i]
+            sub(/.*\//, "", file)
+            source = from[queue[i]]
+            sub(/.*\//, "", source)
+            printf "%-24s %-24s from %s\n", file, why[queue[i]], source
+        }
+        printf "kept %d of %d runtime sources\n", tail - nroots, libs
+    }
+' "$lib/cstartup.src" "$@" "$lib/$math"/*.src "$lib/shared"/*.src "$lib/fileio"/*.src
@@ -0,0 +1,154 @@
+#!/bin/bash
+# Prints the call graph of a program built with INSTRUMENT=YES.
+#
+# usage: callgraph.sh TRACE.8xv program.map [cpu clock in Hz]
+#
+# The TRACE appvar holds the last entry and exit events of the functions of
+# the program, with the cpu cycles they happened at. Replaying them gives the
+# calls of each function, the cycles spent in it and its callees (inclusive)
+# and in it alone (exclusive), and the same for each caller and callee pair.
+# Once the buffer wrapped, functions entered before its oldest event show up
+# as "(earlier)". Functions still running on exit end there.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 TRACE.8xv program.map [cpu clock in Hz]" >&2
+    exit 1
+fi
+
+od -An -v -tu1 "$1" | awk -v mapfile="$2" -v clock="${3:-48000000}" '
+    function hex(text,    i, value) {
+        text = toupper(text)
+        sub(/^(\$|0X)/, "", text)
+        sub(/H$/, "", text)
+        value = 0
+        for (i = 1; i <= length(text); i++) {
+            value = value * 16 + index("0123456789ABCDEF", substr(text, i, 1)) - 1
+        }
+        return value
+    }
+    function word(offset, size,    i, value) {
+        value = 0
+        for (i = size - 1; i >= 0; i--) {
+            value = value * 256 + byte[offset + i]
+        }
+        return value
+    }
+    function unwrap(cycles) {
+        if (cycles + wraps < last) wraps += 2 ^ 32
+        last = cycles + wraps
+        return last
+    }
+    function leave(now,    f, parent, inclusive) {
+        f = stack[depth]
+        inclusive = now - started[depth]
+        calls[f]++
+        self[f] += inclusive - children[depth]
+        if (--active[f] == 0) total[f] += inclusive
+        depth--
+        parent = depth ? stack[depth] : "(root)"
+        if (depth) children[depth] += inclusive
+        edge[parent SUBSEP f] += inclusive
+        edges[parent SUBSEP f]++
+    }
+    function cycles(value) {
+        return sprintf("%d", value)
+    }
+    { for (i = 1; i <= NF; i++) byte[count++] = $i }
+    END {
+        for (start = 0; start + 4 <= count; start++) {
+            if (byte[start] == 73 && byte[start + 1] == 78 && byte[start + 2] == 83 && byte[start + 3] == 84) {
+                break
+            }
+        }
+        if (start + 14 > count) {
+            print "no trace found in the appvar" > "/dev/stderr"
+            exit 1
+        }
+        size = word(start + 4, 3)
+        recorded = word(start + 7, 3)
+        finish = word(start + 10, 4)
+        ring = start + 14
+
+        while ((getline line < mapfile) > 0) {
+            fields = split(line, field, /[ \t]+/)
+            name = ""
+            address = -1
+            for (i = 1; i <= fields; i++) {
+                if (field[i] ~ /^_[A-Za-z0-9_]+$/) {
+                    name = field[i]
+                } else if (address < 0 && field[i] ~ /^(\$|0[xX])?[0-9A-Fa-f]+[hH]?$/ && length(field[i]) >= 6) {
+                    address = hex(field[i])
+                }
+            }
+            if (name != "" && address >= 0 && !(address in named)) named[address] = name
+        }
+
+        events = recorded < size ? recorded : size
+        first = recorded < size ? 0 : recorded % size
+        # functions entered before the oldest event are still running at it
+        depth = 0
+        missing = 0
+        for (e = 0; e < events; e++) {
+            depth += word(ring + ((first + e) % size) * 7, 3) ? 1 : -1
+            if (depth < -missing) missing = -depth
+        }
+        depth = 0
+        for (e = 0; e < events; e++) {
+            offset = ring + ((first + e) % size) * 7
+            address = word(offset, 3)
+            now = unwrap(word(offset + 3, 4))
+            if (e == 0) {
+                while (depth < missing) {
+                    stack[++depth] = "(earlier)"
+                    started[depth] = now
+                    children[depth] = 0
+                    active["(earlier)"]++
+                }
+            }
+            if (address) {
+                f = address in named ? named[address] : sprintf("%06X", address)
+                stack[++depth] = f
+                started[depth] = now
+                children[depth] = 0
+                active[f]++
+            } else if (depth) {
+                leave(now)
+            }
+        }
+        now = events ? unwrap(finish) : 0
+        while (depth) leave(now)
+
+        printf "%d events of %d recorded, cycles at %d Hz\n\n", events, recorded, clock
+        printf "%8s %12s %12s %10s %10s  %s\n", "calls", "inclusive", "exclusive", "avg incl", "avg excl", "function"
+        n = 0
+        for (f in calls) order[n++] = f
+        for (i = 1; i < n; i++) {
+            for (j = i; j > 0 && total[order[j - 1]] < total[order[j]]; j--) {
+                swap = order[j]; order[j] = order[j - 1]; order[j - 1] = swap
+            }
+        }
+        for (i = 0; i < n; i++) {
+            f = order[i]
+            printf "%8d %12s %12s %10s %10s  %s\n", calls[f], cycles(total[f]), cycles(self[f]), cycles(total[f] / calls[f]), cycles(self[f] / calls[f]), f
+        }
+
+        printf "\n%8s %12s  %s\n", "calls", "inclusive", "caller -> callee"
+        for (i = 0; i < n; i++) {
+            caller = order[i]
+            for (j = 0; j < n; j++) {
+                callee = order[j]
+                if ((caller SUBSEP callee) in edges) {
+                    printf "%8d %12s  %s -> %s\n", edges[caller SUBSEP callee], cycles(edge[caller SUBSEP callee]), caller, callee
+                }
+            }
+        }
+        for (j = 0; j < n; j++) {
+            if (("(root)" SUBSEP order[j]) in edges) {
+                printf "%8d %12s  %s -> %s\n", edges["(root)" SUBSEP order[j]], cycles(edge["(root)" SUBSEP order[j]]), "(root)", order[j]
+            }
+        }
+        printf "\n%.6f seconds traced\n", (now - origin) / clock
+    }
+'
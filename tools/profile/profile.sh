@@ -0,0 +1,139 @@
+#!/bin/bash
+# Prints the flat profile of a program built with PROFILE=YES.
+#
+# usage: profile.sh [--fastcode] PROFILE.8xv program.map
+#
+# The PROFILE appvar holds a histogram of the program counter sampled while
+# the program ran. Each bucket of it is split between the functions of the
+# map it covers, in proportion to the bytes of each. With --fastcode, lines of
+# "_function samples size" are printed instead, which FASTCODE_PROFILE takes.
+
+set -e
+
+fastcode=0
+if [ "$1" == "--fastcode" ]; then
+    fastcode=1
+    shift
+fi
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 [--fastcode] PROFILE.8xv program.map" >&2
+    exit 1
+fi
+
+od -An -v -tu1 "$1" | awk -v fastcode=$fastcode -v mapfile="$2" '
+    function hex(text,    i, value) {
+        text = toupper(text)
+        sub(/^(\$|0X)/, "", text)
+        sub(/H$/, "", text)
+        value = 0
+        for (i = 1; i <= length(text); i++) {
+            value = value * 16 + index("0123456789ABCDEF", substr(text, i, 1)) - 1
+        }
+        return value
+    }
+    function word(offset, size,    i, value) {
+        value = 0
+        for (i = size - 1; i >= 0; i--) {
+            value = value * 256 + byte[offset + i]
+        }
+        return value
+    }
+    { for (i = 1; i <= NF; i++) byte[count++] = $i }
+    END {
+        for (start = 0; start + 4 <= count; start++) {
+            if (byte[start] == 80 && byte[start + 1] == 82 && byte[start + 2] == 79 && byte[start + 3] == 70) {
+                break
+            }
+        }
+        if (start + 17 > count) {
+            print "no profile found in the appvar" > "/dev/stderr"
+            exit 1
+        }
+        low = word(start + 4, 3)
+        rate = word(start + 7, 3)
+        buckets = word(start + 10, 3)
+        granularity = 2 ^ byte[start + 13]
+        outside = word(start + 14, 3)
+        high = low + buckets * granularity
+        total = outside
+        for (i = 0; i < buckets; i++) {
+            samples[i] = word(start + 17 + i * 3, 3)
+            total += samples[i]
+        }
+
+        # functions are the symbols of the map within the histogram
+        functions = 0
+        while ((getline line < mapfile) > 0) {
+            fields = split(line, field, /[ \t]+/)
+            name = ""
+            address = -1
+            for (i = 1; i <= fields; i++) {
+                if (field[i] ~ /^_[A-Za-z0-9_]+$/) {
+                    name = field[i]
+                } else if (address < 0 && field[i] ~ /^(\$|0[xX])?[0-9A-Fa-f]+[hH]?$/ && length(field[i]) >= 6) {
+                    address = hex(field[i])
+                }
+            }
+            if (name != "" && address >= low && address < high && !(address in named)) {
+                named[address] = name
+                base[functions++] = address
+            }
+        }
+        if (functions == 0) {
+            print "no symbols of the program found in the map" > "/dev/stderr"
+            exit 1
+        }
+        for (i = 1; i < functions; i++) {
+            for (j = i; j > 0 && base[j - 1] > base[j]; j--) {
+                swap = base[j]; base[j] = base[j - 1]; base[j - 1] = swap
+            }
+        }
+        base[functions] = high
+
+        # spread each bucket over the functions it overlaps
+        f = 0
+        for (i = 0; i < buckets; i++) {
+            if (!samples[i]) continue
+            first = low + i * granularity
+            last = first + granularity
+            if (first < base[0]) {
+                unknown += samples[i] * ((last < base[0] ? last : base[0]) - first) / granularity
+            }
+            while (f > 0 && base[f] > first) f--
+            while (base[f + 1] <= first) f++
+            for (g = f; g < functions && base[g] < last; g++) {
+                from = base[g] > first ? base[g] : first
+                to = base[g + 1] < last ? base[g + 1] : last
+                if (to > from) hits[g] += samples[i] * (to - from) / granularity
+            }
+        }
+
+        if (fastcode) {
+            for (g = 0; g < functions; g++) {
+                if (hits[g] >= 0.5) printf "%s %d %d\n", named[base[g]], hits[g] + 0.5, base[g + 1] - base[g]
+            }
+            exit 0
+        }
+
+        printf "%d samples at %d Hz, %d bytes per bucket\n\n", total, rate, granularity
+        printf "%7s %9s %9s %7s  %s\n", "%time", "seconds", "samples", "size", "function"
+        for (g = 0; g < functions; g++) order[g] = g
+        for (i = 1; i < functions; i++) {
+            for (j = i; j > 0 && hits[order[j - 1]] < hits[order[j]]; j--) {
+                swap = order[j]; order[j] = order[j - 1]; order[j - 1] = swap
+            }
+        }
+        for (i = 0; i < functions; i++) {
+            g = order[i]
+            if (hits[g] < 0.5) break
+            printf "%6.2f%% %9.3f %9.1f %7d  %s\n", hits[g] * 100 / total, hits[g] / rate, hits[g], base[g + 1] - base[g], named[base[g]]
+        }
+        if (unknown >= 0.5) {
+            printf "%6.2f%% %9.3f %9.1f %7s  %s\n", unknown * 100 / total, unknown / rate, unknown, "", "(before the first symbol)"
+        }
+        if (outside) {
+            printf "%6.2f%% %9.3f %9d %7s  %s\n", outside * 100 / total, outside / rate, outside, "", "(outside of the program: os, libraries, fastcode)"
+        }
+    }
+'